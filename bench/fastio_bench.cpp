@@ -0,0 +1,161 @@
+// Throughput of the in-shell cat / head / tail / wc / tee against the coreutils programs.
+//
+//   fastio_bench [size MiB] [directory]
+//
+// A file of text lines is written to directory (default /tmp), then every case moves it once through the builtin,
+// called directly on the fds a pipeline stage would get, and once through the external program started with
+// posix_spawn on the same fds. Pipe ends are fed / drained by threads, the best of three runs is reported.
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FastIO.hpp"
+#include "Spawn.hpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Case {
+        const char* label;
+        const char* program;
+        std::vector<std::string> args;
+        bool pipe_in;  // data file fed through a pipe, otherwise stdin is /dev/null
+        bool pipe_out; // stdout is a pipe drained into /dev/null, otherwise out_file
+    };
+
+    std::string data_file, out_file;
+
+    void drain(int fd) {
+        int null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+        fastio::copy(fd, null_fd);
+        close(null_fd);
+        close(fd);
+    }
+
+    void feed(int fd) {
+        fastio::cat({data_file}, {0, fd, 2});
+        close(fd);
+    }
+
+    std::string program_path(const char* name) {
+        for (const char* dir : {"/usr/bin/", "/bin/"}) {
+            std::string path = std::string(dir) + name;
+            if (access(path.c_str(), X_OK) == 0) return path;
+        }
+        return {};
+    }
+
+    // seconds for one run, -1 when the program isn't there
+    double run(const Case& c, bool builtin) {
+        int in[2] = {-1, -1}, out[2] = {-1, -1};
+        std::thread feeder, drainer;
+        auto start = Clock::now();
+
+        if (c.pipe_in) {
+            pipe2(in, O_CLOEXEC);
+            feeder = std::thread(feed, in[1]);
+        } else {
+            in[0] = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        }
+        if (c.pipe_out) {
+            pipe2(out, O_CLOEXEC);
+            drainer = std::thread(drain, out[0]);
+        } else {
+            out[1] = open(out_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        }
+
+        bool ok = true;
+        if (builtin) {
+            fastio::find(c.program)(c.args, {in[0], out[1], 2});
+        } else {
+            std::string path = program_path(c.program);
+            std::vector<std::string> argv{c.program};
+            argv.insert(argv.end(), c.args.begin(), c.args.end());
+            pid_t pid = path.empty() ? -1
+                                     : spawn_process(path, argv, {FdAction::dup2(in[0], 0), FdAction::dup2(out[1], 1)});
+            ok = pid > 0;
+            if (ok) waitpid(pid, nullptr, 0);
+        }
+
+        close(in[0]);
+        close(out[1]);
+        if (feeder.joinable()) feeder.join();
+        if (drainer.joinable()) drainer.join();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return ok ? seconds : -1;
+    }
+
+    double best_of_three(const Case& c, bool builtin) {
+        double best = 1e30;
+        for (int i = 0; i < 3; ++i) {
+            double t = run(c, builtin);
+            if (t < 0) return -1;
+            best = std::min(best, t);
+        }
+        return best;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t mib = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+    std::string dir = argc > 2 ? argv[2] : "/tmp";
+    data_file = dir + "/fastio_bench.data";
+    out_file = dir + "/fastio_bench.out";
+
+    // lines of 8 to 120 characters, a few words each
+    {
+        FILE* f = std::fopen(data_file.c_str(), "w");
+        if (!f) {
+            std::perror(data_file.c_str());
+            return 1;
+        }
+        std::string line;
+        unsigned seed = 12345;
+        for (size_t written = 0; written < (mib << 20); written += line.size()) {
+            seed = seed * 1103515245 + 12345;
+            line.assign(8 + (seed >> 16) % 113, 'x');
+            for (size_t i = 5; i < line.size(); i += 7) line[i] = ' ';
+            line.back() = '\n';
+            std::fwrite(line.data(), 1, line.size(), f);
+        }
+        std::fclose(f);
+    }
+    double gb = static_cast<double>(mib << 20) / 1e9;
+
+    std::vector<Case> cases = {
+        {"cat file | ...", "cat", {data_file}, false, true},
+        {"cat file > file", "cat", {data_file}, false, false},
+        {"... | cat | ...", "cat", {}, true, true},
+        {"wc -l file", "wc", {"-l", data_file}, false, false},
+        {"wc file", "wc", {data_file}, false, false},
+        {"... | wc -l", "wc", {"-l"}, true, false},
+        {"head -c all file | ...", "head", {"-c", std::to_string(mib << 20), data_file}, false, true},
+        {"tail -n 10 file", "tail", {"-n", "10", data_file}, false, false},
+        {"... | tee file | ...", "tee", {out_file + ".tee"}, true, true},
+    };
+
+    std::printf("%-24s %14s %14s %9s\n", "case", "builtin GB/s", "external GB/s", "speedup");
+    for (const auto& c : cases) {
+        double builtin = best_of_three(c, true);
+        double external = best_of_three(c, false);
+        if (external < 0) {
+            std::printf("%-24s %14.2f %14s %9s\n", c.label, gb / builtin, "-", "-");
+        } else {
+            std::printf("%-24s %14.2f %14.2f %8.1fx\n", c.label, gb / builtin, gb / external, external / builtin);
+        }
+    }
+
+    unlink(data_file.c_str());
+    unlink(out_file.c_str());
+    unlink((out_file + ".tee").c_str());
+    return 0;
+}
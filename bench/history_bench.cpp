@@ -0,0 +1,123 @@
+// Ctrl-R latency over a large synthetic HISTFILE.
+//
+//   history_bench [lines] [histfile]
+//
+// Writes `lines` made-up commands to histfile (default /tmp/history_bench.hist), maps it like the shell does, then
+// replays typing a few queries one key at a time, every keystroke being a search from the newest entry.
+// Each query is timed with the n-gram index and with a plain backwards scan over the history.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "History.hpp"
+#include "HistoryIndex.hpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double us_since(Clock::time_point start) {
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+
+    void write_histfile(const char* path, size_t lines) {
+        const char* templates[] = {
+            "git commit -m \"fix #%u\"", "git checkout feature-%u", "cd ~/src/project%u", "make -j%u",
+            "ssh build%u.example.com", "ls -la /var/log/app%u", "grep -rn TODO src/module%u",
+            "docker run --rm -it image:%u", "vim notes/%u.md", "python3 scripts/run_%u.py --verbose",
+        };
+        std::mt19937 rng(42);
+        std::FILE* f = std::fopen(path, "w");
+        if (!f) {
+            std::perror(path);
+            std::exit(1);
+        }
+        for (size_t i = 0; i < lines; ++i) {
+            std::fprintf(f, templates[rng() % std::size(templates)], unsigned(rng() % 100000));
+            std::fputc('\n', f);
+        }
+        std::fclose(f);
+    }
+
+    size_t scan(History& history, std::string_view query, size_t before) {
+        for (size_t i = before; i-- > 0;) {
+            if (history[i].find(query) != std::string_view::npos) return i;
+        }
+        return HistoryIndex::npos;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t lines = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const char* path = argc > 2 ? argv[2] : "/tmp/history_bench.hist";
+
+    write_histfile(path, lines);
+
+    History history;
+    auto start = Clock::now();
+    history.open_histfile(path);
+    double open_us = us_since(start);
+
+    HistoryIndex index;
+    start = Clock::now();
+    index.update(history);
+    double build_us = us_since(start);
+
+    std::printf("%zu entries, open %.0f us, index build %.1f ms, index %.1f MiB\n\n", history.size(), open_us,
+                build_us / 1000, index.memory_usage() / 1048576.0);
+
+    // typed key by key, the last ones match rarely or never
+    std::vector<std::string> queries = {"git checkout feature-4242", "ssh build7", "docker run --rm -it image:99999",
+                                        "python3 scripts/run_0.py", "no such command anywhere"};
+
+    std::printf("%-34s %14s %14s %14s %14s\n", "query", "index avg us", "index max us", "scan avg us", "scan max us");
+    for (const auto& query : queries) {
+        double index_total = 0, index_max = 0, scan_total = 0, scan_max = 0;
+        for (size_t len = 1; len <= query.size(); ++len) {
+            std::string_view typed = std::string_view(query).substr(0, len);
+
+            start = Clock::now();
+            size_t a = index.search(history, typed, history.size());
+            double t = us_since(start);
+            index_total += t;
+            index_max = std::max(index_max, t);
+
+            start = Clock::now();
+            size_t b = scan(history, typed, history.size());
+            t = us_since(start);
+            scan_total += t;
+            scan_max = std::max(scan_max, t);
+
+            if (a != b) {
+                std::fprintf(stderr, "mismatch for '%.*s': %zu vs %zu\n", int(typed.size()), typed.data(), a, b);
+                return 1;
+            }
+        }
+        std::printf("%-34s %14.1f %14.1f %14.1f %14.1f\n", query.c_str(), index_total / query.size(), index_max,
+                    scan_total / query.size(), scan_max);
+    }
+
+    // Ctrl-R pressed repeatedly: every older match of one query
+    std::string_view query = "make -j12";
+    size_t hits = 0;
+    start = Clock::now();
+    for (size_t at = index.search(history, query, history.size()); at != HistoryIndex::npos;
+         at = index.search(history, query, at)) {
+        hits++;
+    }
+    double walk_us = us_since(start);
+    std::printf("\nrepeated Ctrl-R for '%.*s': %zu matches, %.2f us each\n", int(query.size()), query.data(), hits,
+                hits ? walk_us / hits : 0.0);
+
+    // entries added during the session are indexed incrementally
+    start = Clock::now();
+    for (int i = 0; i < 1000; ++i) {
+        history.push_back("echo session " + std::to_string(i));
+        index.update(history);
+    }
+    std::printf("push_back + index update: %.2f us per entry\n", us_since(start) / 1000);
+    return 0;
+}
@@ -0,0 +1,175 @@
+// Parser throughput: the Lexer + Parser the shell runs on against the old parse_arguments.
+//
+//   parser_bench [corpus file] [rounds]
+//
+// The corpus is one command line per line, e.g. a HISTFILE. Without one, a mix of typical interactive lines and
+// generated-script lines with thousands of arguments is used.
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory_resource>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Parser.hpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // what main.cpp did before, kept here as the baseline
+    std::vector<std::string> parse_arguments(const std::string& args) {
+        std::vector<std::string> arg_list;
+        std::string current_arg;
+        char quote_char = '\0';
+        bool escape_next = false;
+
+        for (const char c : args) {
+            if (escape_next) {
+                if (quote_char == '\"') {
+                    if (c != '\"' && c != '\\') {
+                        current_arg += '\\';
+                    }
+                }
+                current_arg += c;
+                escape_next = false;
+                continue;
+            }
+
+            if (quote_char == '\'') {
+                if (c == '\'') quote_char = '\0';
+                else current_arg += c;
+            } else if (quote_char == '\"') {
+                if (c == '\\') escape_next = true;
+                else if (c == '\"') quote_char = '\0';
+                else current_arg += c;
+            } else {
+                if (c == '\\') {
+                    escape_next = true;
+                } else if (c == '\'' || c == '\"') {
+                    quote_char = c;
+                } else if (std::isspace(static_cast<unsigned char>(c))) {
+                    if (!current_arg.empty()) {
+                        arg_list.push_back(current_arg);
+                        current_arg.clear();
+                    }
+                } else {
+                    current_arg += c;
+                }
+            }
+        }
+
+        if (!current_arg.empty()) {
+            arg_list.push_back(current_arg);
+        }
+        return arg_list;
+    }
+
+    // legacy path: tokens, then split into pipeline stages on "|"
+    size_t legacy(const std::string& line) {
+        std::vector<std::string> tokens = parse_arguments(line);
+        std::vector<std::vector<std::string>> pipeline;
+        std::vector<std::string> current_cmd;
+        for (const auto& token : tokens) {
+            if (token == "|") {
+                pipeline.push_back(current_cmd);
+                current_cmd.clear();
+            } else {
+                current_cmd.push_back(token);
+            }
+        }
+        pipeline.push_back(current_cmd);
+        return tokens.size();
+    }
+
+    size_t words(const ast::List& list) {
+        size_t n = 0;
+        for (const auto& item : list.items) {
+            auto count = [&n](const ast::Pipeline* p) {
+                for (const auto* cmd : p->commands) n += cmd->words.size();
+            };
+            count(item.and_or->first);
+            for (const auto& [op, p] : item.and_or->rest) count(p);
+        }
+        return n;
+    }
+
+    // same setup as Shell::execute_line
+    size_t parsed(const std::string& line) {
+        std::array<std::byte, 4096> initial;
+        std::pmr::monotonic_buffer_resource arena(initial.data(), initial.size());
+        ast::List* list = nullptr;
+        Parser parser(line, &arena);
+        if (parser.parse(list) != Parser::Ok) return 0;
+        return words(*list);
+    }
+
+    std::vector<std::string> generated_corpus() {
+        const char* interactive[] = {
+            "ls -la /var/log",
+            "git commit -m \"fix: don't crash on empty input\"",
+            "grep -rn 'TODO|FIXME' src | sort | uniq -c | sort -rn | head -20",
+            "cd ~/src/project && make -j8 && ./build/app --verbose",
+            "cat access.log | awk '{print $1}' | sort | uniq -c > /tmp/ips.txt 2>/dev/null",
+            "find . -name \\*.o -newer Makefile | xargs rm -f",
+            "(cd build; cmake .. && make) || echo failed",
+            "{ echo header; cat body.txt; } > out.txt",
+            "docker run --rm -it -v \"$PWD\":/work image:latest bash",
+            "echo 'single quoted | not a pipe' \"double \\\"escaped\\\"\" plain\\ space",
+        };
+
+        std::mt19937 rng(7);
+        std::vector<std::string> corpus;
+        for (int i = 0; i < 20000; ++i) corpus.emplace_back(interactive[rng() % std::size(interactive)]);
+
+        // generated scripts: very long argument lists
+        for (int i = 0; i < 200; ++i) {
+            std::string line = "process_files --output /tmp/out" + std::to_string(i);
+            for (int j = 0; j < 2000; ++j) {
+                line += j % 10 ? " data/part-" : " 'data/with space-";
+                line += std::to_string(rng() % 1000000);
+                line += j % 10 ? ".csv" : ".csv'";
+            }
+            corpus.push_back(std::move(line));
+        }
+        return corpus;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> corpus;
+    if (argc > 1) {
+        std::ifstream f(argv[1]);
+        if (!f) {
+            std::perror(argv[1]);
+            return 1;
+        }
+        for (std::string line; std::getline(f, line);) corpus.push_back(std::move(line));
+    } else {
+        corpus = generated_corpus();
+    }
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    size_t bytes = 0;
+    for (const auto& line : corpus) bytes += line.size() + 1;
+    std::printf("%zu lines, %.1f MiB, %d rounds\n\n", corpus.size(), bytes / 1048576.0, rounds);
+    std::printf("%-22s %14s %10s %12s\n", "parser", "lines/s", "MiB/s", "words");
+
+    auto run = [&](const char* name, size_t (*parse)(const std::string&)) {
+        size_t total_words = 0;
+        auto start = Clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (const auto& line : corpus) total_words += parse(line);
+        }
+        double s = std::chrono::duration<double>(Clock::now() - start).count();
+        std::printf("%-22s %14.0f %10.1f %12zu\n", name, corpus.size() * rounds / s, bytes * rounds / 1048576.0 / s,
+                    total_words / rounds);
+    };
+
+    run("parse_arguments (old)", legacy);
+    run("Lexer + Parser", parsed);
+    return 0;
+}
@@ -0,0 +1,722 @@
+// Benchmark suite over the shell's hot paths, results as JSON for tracking regressions between versions.
+//
+//   shell_bench [-o out.json] [--executables N] [--history N] [--corpus N] [--mib N] [--keep]
+//
+// Fixtures are generated in a fresh directory under /tmp: a PATH directory with N executables, a HISTFILE, a
+// corpus of command lines and a data file for pipelines. Measured:
+//   startup.*    Shell construction and completion index ready (PATH snapshot absent / present, HISTFILE mapped),
+//                first prompt of the shell binary on a pty
+//   trie.*       Trie::insert, remove, get_completions, getLongestCommonPrefix
+//   files.*      filename completion over the PATH directory, first read and cached listing
+//   fuzzy.*      set -o fuzzy ranking over 100k generated command names
+//   frecency.*   recording a command with an argument, scoring 100k names for a ranked listing
+//   parser.*     Lexer + Parser throughput over the corpus
+//   dispatch.*   one builtin / one external command through run_string, a builtin with $ expansions
+//   subst.*      lines of ten $( ), in the shell / forked / external, and $(cat data) with the builtin and the program
+//   glob.*       a pattern over the PATH directory, **/*.log over a tree of 400 directories on one thread / the pool
+//   env.*        the exec environment with 100 extra exported variables, cached and rebuilt after a change
+//   pipeline.*   N stage cat pipelines, in-shell stages and `command cat` processes
+// Every entry has min / median / p90 / mean over its samples and says whether lower or higher is better.
+
+#include <fcntl.h>
+#include <pty.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <memory_resource>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "DirCache.hpp"
+#include "Frecency.hpp"
+#include "FuzzyIndex.hpp"
+#include "Glob.hpp"
+#include "Parser.hpp"
+#include "PathIndex.hpp"
+#include "Shell.hpp"
+#include "Trie.hpp"
+#include "Variables.hpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+    namespace fs = std::filesystem;
+
+    struct Options {
+        std::string out;
+        size_t executables = 2000;
+        size_t history = 100000;
+        size_t corpus = 20000;
+        size_t mib = 64;
+        bool keep = false;
+    };
+
+    struct Result {
+        std::string name;
+        std::string unit;
+        bool higher_is_better;
+        std::vector<double> samples;
+    };
+
+    std::vector<Result> results;
+
+    double us_since(Clock::time_point start) {
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+
+    void record(std::string name, std::string unit, bool higher_is_better, std::vector<double> samples) {
+        std::fprintf(stderr, "  %-34s %zu samples\n", name.c_str(), samples.size());
+        results.push_back({std::move(name), std::move(unit), higher_is_better, std::move(samples)});
+    }
+
+    // --- fixtures ---
+
+    struct Fixtures {
+        fs::path root;
+        fs::path bin;
+        fs::path histfile;
+        fs::path data;
+        std::vector<std::string> names;  // executables in bin
+        std::vector<std::string> corpus; // command lines
+    };
+
+    // names with shared prefixes, like a real PATH (git-*, x*, python3.*)
+    std::vector<std::string> make_names(size_t count, std::mt19937& rng) {
+        const char* stems[] = {"git-", "gcc", "g++-", "py", "python3.", "x", "xdg-", "ls", "apt-", "ssh", "docker-",
+                               "k", "kube", "perl", "lib", "systemd-", "grub-", "n", "npm-", "c"};
+        std::vector<std::string> names;
+        names.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            std::string name = stems[rng() % std::size(stems)];
+            size_t tail = 2 + rng() % 9;
+            for (size_t k = 0; k < tail; ++k) name += static_cast<char>('a' + rng() % 26);
+            name += std::to_string(i); // unique
+            names.push_back(std::move(name));
+        }
+        return names;
+    }
+
+    std::vector<std::string> make_corpus(size_t count, const std::vector<std::string>& names, std::mt19937& rng) {
+        const char* templates[] = {
+            "ls -la /var/log/app%u",
+            "git commit -m \"fix #%u: don't crash\"",
+            "grep -rn 'TODO %u' src | sort | uniq -c | sort -rn | head",
+            "make -j%u 2>&1 | tee build.log",
+            "cd ~/src/project%u && make && ./run --verbose",
+            "echo \"a\\\"b\" 'c d' e\\ f %u > out.txt",
+            "find . -name '*.cpp' -newer stamp%u -print0 | xargs -0 wc -l",
+            "{ echo start; cat in%u.txt; } >> log 2>&1",
+        };
+        std::vector<std::string> corpus;
+        corpus.reserve(count);
+        char line[256];
+        for (size_t i = 0; i < count; ++i) {
+            if (i % 50 == 49) {
+                // generated scripts: one command with a few thousand arguments
+                std::string big = names[rng() % names.size()];
+                for (int k = 0; k < 2000; ++k) big += " arg" + std::to_string(rng() % 100000);
+                corpus.push_back(std::move(big));
+                continue;
+            }
+            std::snprintf(line, sizeof(line), templates[rng() % std::size(templates)], unsigned(rng() % 100000));
+            corpus.emplace_back(line);
+        }
+        return corpus;
+    }
+
+    Fixtures make_fixtures(const Options& opts) {
+        Fixtures fx;
+        char dir_template[] = "/tmp/shell_bench.XXXXXX";
+        if (!mkdtemp(dir_template)) {
+            std::perror("mkdtemp");
+            std::exit(1);
+        }
+        fx.root = dir_template;
+        fx.bin = fx.root / "bin";
+        fs::create_directories(fx.bin);
+
+        std::mt19937 rng(42);
+        fx.names = make_names(opts.executables, rng);
+        for (const auto& name : fx.names) {
+            std::string path = (fx.bin / name).string();
+            int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0755);
+            if (fd >= 0) {
+                (void) !write(fd, "#!/bin/sh\n", 10);
+                close(fd);
+            }
+        }
+
+        fx.corpus = make_corpus(opts.corpus, fx.names, rng);
+
+        fx.histfile = fx.root / "histfile";
+        if (std::FILE* f = std::fopen(fx.histfile.c_str(), "w")) {
+            for (size_t i = 0; i < opts.history; ++i) {
+                const std::string& line = fx.corpus[i % fx.corpus.size()];
+                // scripts' huge lines don't end up in an interactive history
+                if (line.size() > 256) continue;
+                std::fputs(line.c_str(), f);
+                std::fputc('\n', f);
+            }
+            std::fclose(f);
+        }
+
+        fx.data = fx.root / "data";
+        if (std::FILE* f = std::fopen(fx.data.c_str(), "w")) {
+            std::string line;
+            for (size_t written = 0; written < (opts.mib << 20); written += line.size()) {
+                line = fx.names[rng() % fx.names.size()] + " " + std::to_string(rng()) + "\n";
+                std::fwrite(line.data(), 1, line.size(), f);
+            }
+            std::fclose(f);
+        }
+
+        // the shell under test sees only the fixtures (plus the system's true / cat)
+        std::string path = fx.bin.string() + ":/usr/bin:/bin";
+        setenv("PATH", path.c_str(), 1);
+        setenv("HISTFILE", fx.histfile.c_str(), 1);
+        setenv("XDG_CACHE_HOME", (fx.root / "cache").c_str(), 1);
+        return fx;
+    }
+
+    // --- benchmarks ---
+
+    // exec the shell on a pty and wait for its first prompt, -1 when it can't be started
+    double time_to_prompt(const std::string& shell) {
+        int master = -1;
+        auto start = Clock::now();
+        pid_t pid = forkpty(&master, nullptr, nullptr, nullptr);
+        if (pid < 0) return -1;
+        if (pid == 0) {
+            execl(shell.c_str(), shell.c_str(), static_cast<char*>(nullptr));
+            _exit(127);
+        }
+
+        std::string seen;
+        char buf[512];
+        while (seen.find("$ ") == std::string::npos) {
+            ssize_t n = read(master, buf, sizeof(buf));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            seen.append(buf, n);
+        }
+        double us = seen.find("$ ") == std::string::npos ? -1 : us_since(start);
+
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+        close(master);
+        return us;
+    }
+
+    void bench_startup() {
+        fs::path snapshot = PathIndex::default_snapshot_path();
+        // construction returns before the PATH scan is done, *_index also waits for the completion index
+        std::vector<double> cold, warm, cold_index, warm_index;
+        for (int i = 0; i < 10; ++i) {
+            fs::remove(snapshot);
+            auto start = Clock::now();
+            Shell shell{true};
+            cold.push_back(us_since(start));
+            shell.wait_for_index();
+            cold_index.push_back(us_since(start));
+        }
+        for (int i = 0; i < 30; ++i) {
+            auto start = Clock::now();
+            Shell shell{true};
+            warm.push_back(us_since(start));
+            shell.wait_for_index();
+            warm_index.push_back(us_since(start));
+        }
+        record("startup.cold", "us", false, cold);
+        record("startup.warm", "us", false, warm);
+        record("startup.cold_index", "us", false, cold_index);
+        record("startup.warm_index", "us", false, warm_index);
+
+        // the shell binary next to this one: exec, dynamic loading, construction and drawing the prompt
+        std::string shell_path = (fs::read_symlink("/proc/self/exe").parent_path() / "shell").string();
+        if (access(shell_path.c_str(), X_OK) == 0) {
+            std::vector<double> prompt_cold, prompt_warm;
+            for (int i = 0; i < 10; ++i) {
+                fs::remove(snapshot);
+                if (double us = time_to_prompt(shell_path); us >= 0) prompt_cold.push_back(us);
+            }
+            for (int i = 0; i < 30; ++i) {
+                if (double us = time_to_prompt(shell_path); us >= 0) prompt_warm.push_back(us);
+            }
+            if (!prompt_cold.empty()) record("startup.first_prompt_cold", "us", false, prompt_cold);
+            if (!prompt_warm.empty()) record("startup.first_prompt_warm", "us", false, prompt_warm);
+        } else {
+            std::fprintf(stderr, "  %s not found, skipping startup.first_prompt_*\n", shell_path.c_str());
+        }
+
+        std::vector<double> plain;
+        for (int i = 0; i < 100; ++i) {
+            auto start = Clock::now();
+            { Shell shell{false}; }
+            plain.push_back(us_since(start));
+        }
+        record("startup.non_interactive", "us", false, plain);
+    }
+
+    void bench_trie(const Fixtures& fx) {
+        std::vector<double> insert;
+        for (int round = 0; round < 10; ++round) {
+            Trie trie;
+            auto start = Clock::now();
+            for (const auto& name : fx.names) trie.insert(name);
+            insert.push_back(us_since(start) * 1000 / fx.names.size());
+        }
+        record("trie.insert", "ns/op", false, insert);
+
+        // a package manager removing everything it installed, as the PATH watcher applies it
+        std::vector<double> remove;
+        for (int round = 0; round < 10; ++round) {
+            Trie trie;
+            for (const auto& name : fx.names) trie.insert(name);
+            auto start = Clock::now();
+            for (const auto& name : fx.names) trie.remove(name);
+            remove.push_back(us_since(start) * 1000 / fx.names.size());
+        }
+        record("trie.remove", "ns/op", false, remove);
+
+        Trie trie;
+        for (const auto& name : fx.names) trie.insert(name);
+
+        // what a user types before TAB: 1 to 4 characters of an existing name
+        std::vector<std::string> prefixes;
+        for (size_t i = 0; i < fx.names.size(); i += std::max<size_t>(1, fx.names.size() / 200)) {
+            for (size_t len = 1; len <= 4 && len <= fx.names[i].size(); ++len) prefixes.push_back(fx.names[i].substr(0, len));
+        }
+
+        std::vector<double> completions, completions_page, lcp;
+        size_t sink = 0;
+        for (const auto& prefix : prefixes) {
+            auto start = Clock::now();
+            sink += trie.get_completions(prefix).size();
+            completions.push_back(us_since(start));
+
+            start = Clock::now();
+            sink += trie.get_completions(prefix, 2).size(); // the shell's "one or many" probe
+            completions_page.push_back(us_since(start));
+
+            start = Clock::now();
+            sink += trie.getLongestCommonPrefix(prefix).size();
+            lcp.push_back(us_since(start));
+        }
+        record("trie.get_completions", "us", false, completions);
+        record("trie.get_completions_limit2", "us", false, completions_page);
+        record("trie.longest_common_prefix", "us", false, lcp);
+        if (sink == 0) std::fprintf(stderr, "no completions?\n");
+    }
+
+    void bench_files(const Fixtures& fx) {
+        std::string dir = fx.bin.string();
+        // a directory changed in the last seconds is read again on every TAB, the fixtures were just written
+        fs::last_write_time(fx.bin, fs::last_write_time(fx.bin) - std::chrono::minutes(1));
+
+        std::vector<std::string> prefixes;
+        for (size_t i = 0; i < fx.names.size(); i += std::max<size_t>(1, fx.names.size() / 200)) {
+            prefixes.push_back(fx.names[i].substr(0, std::min<size_t>(2, fx.names[i].size())));
+        }
+
+        // what one TAB costs: the "one or many" probe, then the common prefix
+        auto tab = [&dir](DirCache& cache, const std::string& prefix) {
+            size_t n = cache.for_each(dir, prefix, [](const DirCache::Match&) { return false; });
+            return n + cache.common_prefix(dir, prefix).size();
+        };
+
+        std::vector<double> cold, warm;
+        size_t sink = 0;
+        for (int round = 0; round < 20; ++round) {
+            DirCache cache;
+            auto start = Clock::now();
+            sink += tab(cache, prefixes[round % prefixes.size()]);
+            cold.push_back(us_since(start));
+        }
+
+        DirCache cache;
+        tab(cache, prefixes[0]);
+        for (const auto& prefix : prefixes) {
+            auto start = Clock::now();
+            sink += tab(cache, prefix);
+            warm.push_back(us_since(start));
+        }
+        record("files.complete_cold", "us", false, cold);
+        record("files.complete_cached", "us", false, warm);
+        if (sink == 0) std::fprintf(stderr, "no file completions?\n");
+    }
+
+    void bench_fuzzy() {
+        std::mt19937 rng(7);
+        std::vector<std::string> names = make_names(100000, rng);
+        FuzzyIndex index;
+
+        std::vector<double> build;
+        for (int round = 0; round < 5; ++round) {
+            auto start = Clock::now();
+            index.clear();
+            for (const auto& name : names) index.add(name);
+            build.push_back(us_since(start));
+        }
+
+        // fragments of real names with letters left out, what a half-remembered command looks like
+        std::vector<std::string> patterns;
+        for (size_t i = 0; i < 200; ++i) {
+            const std::string& name = names[rng() % names.size()];
+            std::string pattern;
+            for (size_t k = 0; k < name.size() && pattern.size() < 5; ++k) {
+                if (rng() % 2) pattern += name[k];
+            }
+            if (!pattern.empty()) patterns.push_back(pattern);
+        }
+
+        std::vector<double> rank;
+        size_t sink = 0;
+        for (const auto& pattern : patterns) {
+            auto start = Clock::now();
+            sink += index.best(pattern, 60).size();
+            rank.push_back(us_since(start));
+        }
+        record("fuzzy.build_100k", "us", false, build);
+        record("fuzzy.rank_100k", "us", false, rank);
+        if (sink == 0) std::fprintf(stderr, "no fuzzy matches?\n");
+    }
+
+    void bench_frecency() {
+        std::mt19937 rng(11);
+        std::vector<std::string> names = make_names(100000, rng);
+        Frecency frecency;
+
+        // a few names used a lot, most never: what a real history looks like
+        std::vector<double> use;
+        for (size_t i = 0; i < 20000; ++i) {
+            size_t pick = std::min<size_t>(names.size() - 1, static_cast<size_t>(std::exp2((rng() % 1600) / 100.0)));
+            auto start = Clock::now();
+            frecency.use(names[pick]);
+            frecency.use(names[pick], names[(pick * 7) % names.size()]);
+            use.push_back(us_since(start) * 1000);
+        }
+
+        // a double TAB on an empty word scores every command name
+        std::vector<double> rank;
+        double sink = 0;
+        for (int round = 0; round < 10; ++round) {
+            auto start = Clock::now();
+            for (const auto& name : names) sink += frecency.score(name);
+            rank.push_back(us_since(start));
+        }
+        record("frecency.use", "ns", false, use);
+        record("frecency.score_100k", "us", false, rank);
+        if (sink == 0) std::fprintf(stderr, "no frecency scores?\n");
+    }
+
+    void bench_parser(const Fixtures& fx) {
+        size_t bytes = 0;
+        for (const auto& line : fx.corpus) bytes += line.size();
+
+        std::vector<double> lines_per_s, mb_per_s;
+        std::array<std::byte, 64 * 1024> initial;
+        for (int round = 0; round < 10; ++round) {
+            size_t words = 0;
+            auto start = Clock::now();
+            for (const auto& line : fx.corpus) {
+                std::pmr::monotonic_buffer_resource arena(initial.data(), initial.size());
+                ast::List* list = nullptr;
+                Parser parser(line, &arena);
+                if (parser.parse(list) == Parser::Ok) words += list->items.size();
+            }
+            double s = us_since(start) / 1e6;
+            lines_per_s.push_back(fx.corpus.size() / s);
+            mb_per_s.push_back(bytes / s / 1e6);
+            if (words == 0) std::fprintf(stderr, "nothing parsed?\n");
+        }
+        record("parser.lines", "lines/s", true, lines_per_s);
+        record("parser.bytes", "MB/s", true, mb_per_s);
+    }
+
+    // stdout of the shell under test goes to /dev/null while timing
+    void bench_dispatch() {
+        Shell shell{false};
+        auto time_command = [&shell](const char* command, int iterations) {
+            std::vector<double> samples;
+            for (int i = 0; i < iterations; ++i) {
+                auto start = Clock::now();
+                shell.run_string(command);
+                samples.push_back(us_since(start));
+            }
+            return samples;
+        };
+
+        record("dispatch.builtin", "us", false, time_command("pwd", 2000));
+        record("dispatch.builtin_redirected", "us", false, time_command("echo hi > /dev/null", 2000));
+        record("dispatch.builtin_expanded", "us", false, time_command("echo $HOME ${UNSET:-x} > /dev/null", 2000));
+        record("dispatch.external", "us", false, time_command("true", 300));
+        record("dispatch.external_pipeline2", "us", false, time_command("true | true", 300));
+    }
+
+    // $( ) heavy lines: builtins captured in the shell against the same builtins in a forked subshell (a list always
+    // gets one, so that is what a shell that forks for every $( ) pays), external commands, bulk output
+    void bench_substitution(const Fixtures& fx, size_t mib) {
+        Shell shell{false};
+        auto ten = [](const char* substitution) {
+            std::string line = "X=";
+            for (int i = 0; i < 10; ++i) line += substitution;
+            return line;
+        };
+        auto time_command = [&shell](const std::string& command, int iterations) {
+            std::vector<double> samples;
+            for (int i = 0; i < iterations; ++i) {
+                auto start = Clock::now();
+                shell.run_string(command);
+                samples.push_back(us_since(start));
+            }
+            return samples;
+        };
+
+        record("subst.builtin_x10", "us", false, time_command(ten("$(echo a)"), 2000));
+        record("subst.builtin_forked_x10", "us", false, time_command(ten("$(cd . && echo a)"), 100));
+        record("subst.external_x10", "us", false, time_command(ten("$(true)"), 100));
+
+        double mb = static_cast<double>(mib << 20) / 1e6;
+        std::string data = fx.data.string();
+        for (bool external : {false, true}) {
+            std::string command = std::string("X=$(") + (external ? "command cat " : "cat ") + data + ")";
+            std::vector<double> samples;
+            for (int round = 0; round < 3; ++round) {
+                auto start = Clock::now();
+                shell.run_string(command);
+                samples.push_back(mb / (us_since(start) / 1e6));
+            }
+            record(external ? "subst.output_external" : "subst.output_builtin", "MB/s", true, samples);
+        }
+        shell.run_string("unset X");
+    }
+
+    // the envp handed to every spawn: reused as is, rebuilt after an exported variable changed
+    void bench_glob(const Fixtures& fx) {
+        // 20 x 20 directories of 20 files, every third one a .log
+        fs::path tree = fx.root / "tree";
+        for (int i = 0; i < 20; ++i) {
+            for (int j = 0; j < 20; ++j) {
+                fs::path dir = tree / ("d" + std::to_string(i)) / ("e" + std::to_string(j));
+                fs::create_directories(dir);
+                for (int k = 0; k < 20; ++k) {
+                    std::string name = "f" + std::to_string(k) + (k % 3 == 0 ? ".log" : ".txt");
+                    int fd = open((dir / name).c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+                    if (fd >= 0) close(fd);
+                }
+            }
+        }
+
+        auto run = [](Glob& glob, const std::string& pattern, size_t rounds, size_t& sink) {
+            std::vector<double> samples;
+            for (size_t round = 0; round < rounds; ++round) {
+                auto start = Clock::now();
+                sink += glob.expand(pattern).size();
+                samples.push_back(us_since(start));
+            }
+            return samples;
+        };
+
+        size_t sink = 0;
+        Glob serial;
+        ThreadPool pool;
+        Glob parallel(&pool);
+        record("glob.path_dir", "us", false, run(serial, fx.bin.string() + "/git-*", 200, sink));
+        record("glob.recursive", "us", false, run(serial, tree.string() + "/**/*.log", 30, sink));
+        record("glob.recursive_pool", "us", false, run(parallel, tree.string() + "/**/*.log", 30, sink));
+        if (sink == 0) std::fprintf(stderr, "no glob matches?\n");
+    }
+
+    void bench_environment() {
+        Variables vars;
+        vars.import_environment(environ);
+        std::string value(40, 'v');
+        for (int i = 0; i < 100; ++i) vars.export_name("SHELL_BENCH_" + std::to_string(i), &value);
+
+        std::vector<double> cached, rebuilt;
+        size_t sink = 0;
+        for (int i = 0; i < 10000; ++i) {
+            auto start = Clock::now();
+            sink += vars.envp()[0] != nullptr;
+            cached.push_back(us_since(start) * 1000);
+        }
+        for (int i = 0; i < 1000; ++i) {
+            vars.set("SHELL_BENCH_0", std::to_string(i));
+            auto start = Clock::now();
+            sink += vars.envp()[0] != nullptr;
+            rebuilt.push_back(us_since(start));
+        }
+        for (int i = 0; i < 100; ++i) vars.unset("SHELL_BENCH_" + std::to_string(i));
+
+        record("env.envp_cached", "ns", false, cached);
+        record("env.envp_rebuilt", "us", false, rebuilt);
+        if (sink == 0) std::fprintf(stderr, "empty environment?\n");
+    }
+
+    void bench_pipelines(const Fixtures& fx, size_t mib) {
+        Shell shell{false};
+        double mb = static_cast<double>(mib << 20) / 1e6;
+        std::string data = fx.data.string();
+
+        for (int stages : {1, 2, 4, 8}) {
+            for (bool external : {false, true}) {
+                const char* cat = external ? "command cat" : "cat";
+                std::string command = std::string(cat) + " " + data;
+                for (int i = 1; i < stages; ++i) command += std::string(" | ") + cat;
+                command += " > /dev/null";
+
+                std::vector<double> samples;
+                for (int round = 0; round < 5; ++round) {
+                    auto start = Clock::now();
+                    shell.run_string(command);
+                    samples.push_back(mb / (us_since(start) / 1e6));
+                }
+                record("pipeline.cat" + std::to_string(stages) + (external ? ".external" : ".builtin"), "MB/s", true,
+                       samples);
+            }
+        }
+
+        std::vector<double> wc;
+        for (int round = 0; round < 5; ++round) {
+            auto start = Clock::now();
+            shell.run_string("cat " + data + " | wc -l");
+            wc.push_back(mb / (us_since(start) / 1e6));
+        }
+        record("pipeline.cat_wc_l", "MB/s", true, wc);
+    }
+
+    // --- output ---
+
+    std::string json_escape(const std::string& text) {
+        std::string out;
+        for (char c : text) {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
+        return out;
+    }
+
+    std::string to_json(const Options& opts) {
+        std::string json = "{\n";
+        char buf[512];
+        std::snprintf(buf, sizeof(buf),
+                      "  \"version\": 1,\n  \"timestamp\": %lld,\n  \"compiler\": \"%s\",\n"
+                      "  \"fixtures\": {\"executables\": %zu, \"history_lines\": %zu, \"corpus_lines\": %zu, "
+                      "\"pipeline_mib\": %zu},\n",
+                      static_cast<long long>(std::time(nullptr)), json_escape(__VERSION__).c_str(), opts.executables,
+                      opts.history, opts.corpus, opts.mib);
+        json += buf;
+        json += "  \"benchmarks\": [\n";
+
+        for (size_t i = 0; i < results.size(); ++i) {
+            auto samples = results[i].samples;
+            std::sort(samples.begin(), samples.end());
+            double mean = 0;
+            for (double s : samples) mean += s;
+            mean /= samples.empty() ? 1 : samples.size();
+            auto at = [&samples](double q) {
+                return samples.empty() ? 0 : samples[std::min(samples.size() - 1, size_t(q * samples.size()))];
+            };
+
+            std::snprintf(buf, sizeof(buf),
+                          "    {\"name\": \"%s\", \"unit\": \"%s\", \"better\": \"%s\", \"samples\": %zu, "
+                          "\"min\": %.3f, \"median\": %.3f, \"p90\": %.3f, \"max\": %.3f, \"mean\": %.3f}%s\n",
+                          json_escape(results[i].name).c_str(), results[i].unit.c_str(),
+                          results[i].higher_is_better ? "higher" : "lower", samples.size(),
+                          samples.empty() ? 0 : samples.front(), at(0.5), at(0.9),
+                          samples.empty() ? 0 : samples.back(), mean, i + 1 < results.size() ? "," : "");
+            json += buf;
+        }
+        json += "  ]\n}\n";
+        return json;
+    }
+
+    Options parse_options(int argc, char** argv) {
+        Options opts;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto number = [&]() -> size_t {
+                if (i + 1 >= argc) {
+                    std::fprintf(stderr, "%s needs a value\n", arg.c_str());
+                    std::exit(2);
+                }
+                return std::strtoul(argv[++i], nullptr, 10);
+            };
+            if (arg == "-o" && i + 1 < argc) opts.out = argv[++i];
+            else if (arg == "--executables") opts.executables = std::max<size_t>(1, number());
+            else if (arg == "--history") opts.history = number();
+            else if (arg == "--corpus") opts.corpus = std::max<size_t>(1, number());
+            else if (arg == "--mib") opts.mib = std::max<size_t>(1, number());
+            else if (arg == "--keep") opts.keep = true;
+            else {
+                std::fprintf(stderr,
+                             "usage: shell_bench [-o out.json] [--executables N] [--history N] [--corpus N] "
+                             "[--mib N] [--keep]\n");
+                std::exit(2);
+            }
+        }
+        return opts;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options opts = parse_options(argc, argv);
+
+    std::fprintf(stderr, "generating fixtures...\n");
+    Fixtures fx = make_fixtures(opts);
+    std::fprintf(stderr, "fixtures in %s\n", fx.root.c_str());
+
+    // the shell under test must neither take the terminal nor write over the JSON
+    int saved_in = dup(STDIN_FILENO);
+    int saved_out = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+    std::fflush(stdout);
+    dup2(null_fd, STDIN_FILENO);
+    dup2(null_fd, STDOUT_FILENO);
+
+    bench_startup();
+    bench_trie(fx);
+    bench_files(fx);
+    bench_fuzzy();
+    bench_frecency();
+    bench_parser(fx);
+    bench_dispatch();
+    bench_glob(fx);
+    bench_environment();
+    bench_substitution(fx, opts.mib);
+    bench_pipelines(fx, opts.mib);
+
+    std::cout.flush();
+    dup2(saved_in, STDIN_FILENO);
+    dup2(saved_out, STDOUT_FILENO);
+    close(saved_in);
+    close(saved_out);
+    close(null_fd);
+
+    std::string json = to_json(opts);
+    if (opts.out.empty()) {
+        std::fputs(json.c_str(), stdout);
+    } else if (std::FILE* f = std::fopen(opts.out.c_str(), "w")) {
+        std::fputs(json.c_str(), f);
+        std::fclose(f);
+    } else {
+        std::perror(opts.out.c_str());
+        return 1;
+    }
+
+    if (!opts.keep) fs::remove_all(fx.root);
+    return 0;
+}
@@ -0,0 +1,75 @@
+// Spawn latency as a function of the parent's resident set size.
+//
+//   spawn_bench [iterations] [rss MiB...]
+//
+// For every RSS the process first allocates and touches that much memory (like a shell holding a big history
+// and completion index), then times fork()+execv() against posix_spawn() of /bin/true, including the wait.
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "Spawn.hpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const char* TRUE_BIN = "/bin/true";
+
+    double fork_exec_us(int iterations) {
+        char* argv[] = {const_cast<char*>(TRUE_BIN), nullptr};
+        auto start = Clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                execv(TRUE_BIN, argv);
+                _exit(127);
+            }
+            waitpid(pid, nullptr, 0);
+        }
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / iterations;
+    }
+
+    double spawn_us(int iterations) {
+        char* argv[] = {const_cast<char*>(TRUE_BIN), nullptr};
+        auto start = Clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            pid_t pid = spawn_process(TRUE_BIN, argv);
+            if (pid < 0) {
+                std::perror("spawn");
+                std::exit(1);
+            }
+            waitpid(pid, nullptr, 0);
+        }
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / iterations;
+    }
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+    std::vector<size_t> sizes;
+    for (int i = 2; i < argc; ++i) sizes.push_back(std::strtoul(argv[i], nullptr, 10));
+    if (sizes.empty()) sizes = {0, 64, 256, 1024};
+
+    std::printf("%10s %16s %16s %10s\n", "rss MiB", "fork+exec us", "posix_spawn us", "speedup");
+
+    std::vector<std::vector<char>> ballast;
+    size_t held = 0;
+    for (size_t mib : sizes) {
+        // grow the resident set to the requested size, touching every page
+        if (mib > held) {
+            ballast.emplace_back((mib - held) << 20, 1);
+            held = mib;
+        }
+
+        double forked = fork_exec_us(iterations);
+        double spawned = spawn_us(iterations);
+        std::printf("%10zu %16.1f %16.1f %9.1fx\n", mib, forked, spawned, forked / spawned);
+    }
+    return 0;
+}
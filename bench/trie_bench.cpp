@@ -0,0 +1,254 @@
+// Compares the arena radix Trie with the previous unordered_map-per-node trie.
+//
+//   trie_bench [words] [--path]
+//
+// words defaults to 50000 synthetic executable names, --path uses the executables of $PATH instead.
+
+#include <malloc.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <new>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Trie.hpp"
+
+// live heap bytes, every allocation of the process goes through here
+static size_t live_bytes = 0;
+
+void* operator new(size_t size) {
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    live_bytes += malloc_usable_size(p);
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    live_bytes -= malloc_usable_size(p);
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+// the trie this repo used before, kept here as the baseline
+namespace legacy {
+    class TrieNode {
+    public:
+        bool endofWord;
+        std::unordered_map<char, TrieNode*> children;
+
+        TrieNode() : endofWord(false) {}
+
+        ~TrieNode() {
+            for (auto& pair : children) {
+                delete pair.second;
+            }
+        }
+    };
+
+    class Trie {
+        TrieNode* root;
+
+        static void collectAllWords(TrieNode* node, const std::string& currentPrefix, std::vector<std::string>& results) {
+            if (node->endofWord) {
+                results.push_back(currentPrefix);
+            }
+            for (auto const& [ch, childNode] : node->children) {
+                collectAllWords(childNode, currentPrefix + ch, results);
+            }
+        }
+
+    public:
+        Trie() { root = new TrieNode(); }
+        ~Trie() { delete root; }
+
+        void insert(const std::string& word) const {
+            TrieNode* node = root;
+            for (char c : word) {
+                if (node->children.find(c) == node->children.end()) {
+                    node->children[c] = new TrieNode();
+                }
+                node = node->children[c];
+            }
+            node->endofWord = true;
+        }
+
+        std::vector<std::string> get_completions(const std::string& prefix) {
+            TrieNode* node = root;
+            for (char c : prefix) {
+                if (node->children.find(c) == node->children.end()) {
+                    return {};
+                }
+                node = node->children[c];
+            }
+            std::vector<std::string> results;
+            collectAllWords(node, prefix, results);
+            return results;
+        }
+
+        std::string getLongestCommonPrefix(std::string prefix) const {
+            TrieNode* node = root;
+            for (char c : prefix) {
+                if (node->children.find(c) == node->children.end()) {
+                    return prefix;
+                }
+                node = node->children[c];
+            }
+            std::string lcp = prefix;
+            while (node->children.size() == 1 && !node->endofWord) {
+                auto it = node->children.begin();
+                lcp += it->first;
+                node = it->second;
+            }
+            return lcp;
+        }
+    };
+}
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double elapsed_ns(Clock::time_point start) {
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    std::vector<std::string> synthetic_names(size_t count) {
+        // stems that show up a lot in real bin directories
+        const char* stems[] = {"", "lib", "x86_64-linux-gnu-", "python3.", "git-", "kube", "perl5.", "gcc-",
+                               "docker-", "systemd-", "llvm-", "node-", "g", "x", "py", "aws-"};
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> stem(0, std::size(stems) - 1);
+        std::uniform_int_distribution<int> len(3, 12);
+        std::uniform_int_distribution<int> ch(0, 36);
+
+        std::vector<std::string> names;
+        names.reserve(count);
+        while (names.size() < count) {
+            std::string name = stems[stem(rng)];
+            for (int i = len(rng); i > 0; --i) {
+                int c = ch(rng);
+                name += c < 26 ? char('a' + c) : c < 36 ? char('0' + c - 26) : '-';
+            }
+            names.push_back(std::move(name));
+        }
+        std::sort(names.begin(), names.end());
+        names.erase(std::unique(names.begin(), names.end()), names.end());
+        std::shuffle(names.begin(), names.end(), rng);
+        return names;
+    }
+
+    std::vector<std::string> path_names() {
+        std::vector<std::string> names;
+        const char* path_env = std::getenv("PATH");
+        if (!path_env) return names;
+
+        std::string_view rest(path_env);
+        while (!rest.empty()) {
+            size_t colon = rest.find(':');
+            std::string dir(rest.substr(0, colon));
+            rest = colon == std::string_view::npos ? std::string_view{} : rest.substr(colon + 1);
+
+            std::error_code ec;
+            for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+                names.push_back(entry.path().filename().string());
+            }
+        }
+        return names;
+    }
+
+    struct Result {
+        size_t bytes = 0;
+        double insert_ns = 0;
+        double completion_ns[3] = {};
+        double lcp_ns = 0;
+        size_t matches = 0;
+    };
+
+    template <typename T>
+    Result run(const std::vector<std::string>& names, const std::vector<std::string> (&prefixes)[3]) {
+        Result r;
+        size_t before = live_bytes;
+
+        auto* trie = new T();
+        auto start = Clock::now();
+        for (const auto& name : names) trie->insert(name);
+        r.insert_ns = elapsed_ns(start) / names.size();
+        r.bytes = live_bytes - before;
+
+        for (int len = 0; len < 3; ++len) {
+            start = Clock::now();
+            for (const auto& prefix : prefixes[len]) {
+                r.matches += trie->get_completions(prefix).size();
+            }
+            r.completion_ns[len] = elapsed_ns(start) / prefixes[len].size();
+        }
+
+        start = Clock::now();
+        size_t total = 0;
+        for (const auto& name : names) {
+            total += trie->getLongestCommonPrefix(name.substr(0, name.size() / 2)).size();
+        }
+        r.lcp_ns = elapsed_ns(start) / names.size();
+        if (total == 0) std::puts("");
+
+        delete trie;
+        return r;
+    }
+
+    void print(const char* label, const Result& r) {
+        std::printf("%-8s %10.2f MiB %12.1f %14.1f %14.1f %14.1f %12.1f\n", label, r.bytes / (1024.0 * 1024.0),
+                    r.insert_ns, r.completion_ns[0] / 1000, r.completion_ns[1] / 1000, r.completion_ns[2] / 1000,
+                    r.lcp_ns);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t count = 50000;
+    bool from_path = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--path") == 0) from_path = true;
+        else count = std::strtoul(argv[i], nullptr, 10);
+    }
+
+    std::vector<std::string> names = from_path ? path_names() : synthetic_names(count);
+    if (names.empty()) {
+        std::fprintf(stderr, "trie_bench: no words\n");
+        return 1;
+    }
+
+    // prefixes of 1, 2 and 3 bytes taken from the words themselves
+    std::vector<std::string> prefixes[3];
+    std::mt19937 rng(7);
+    for (int len = 0; len < 3; ++len) {
+        for (int i = 0; i < 200; ++i) {
+            const std::string& name = names[rng() % names.size()];
+            prefixes[len].push_back(name.substr(0, len + 1));
+        }
+    }
+
+    Result legacy_result = run<legacy::Trie>(names, prefixes);
+    Result radix_result = run<Trie>(names, prefixes);
+
+    if (legacy_result.matches != radix_result.matches) {
+        std::fprintf(stderr, "trie_bench: completion results differ (%zu vs %zu)\n", legacy_result.matches,
+                     radix_result.matches);
+        return 1;
+    }
+
+    std::printf("%zu words, %zu completions\n\n", names.size(), radix_result.matches);
+    std::printf("%-8s %14s %12s %14s %14s %14s %12s\n", "trie", "memory", "insert ns", "complete1 us",
+                "complete2 us", "complete3 us", "lcp ns");
+    print("legacy", legacy_result);
+    print("radix", radix_result);
+    return 0;
+}
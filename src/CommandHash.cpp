@@ -0,0 +1,105 @@
+#include "CommandHash.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+// Command path cache, replaces walking PATH for every command
+
+std::string CommandHash::find_in_path(const std::string& cmd, const char* path_env) {
+    if (!path_env) return "";
+
+    std::string full_path;
+    const char* dir = path_env;
+    while (true) {
+        const char* end = std::strchr(dir, ':');
+        size_t len = end ? static_cast<size_t>(end - dir) : std::strlen(dir);
+
+        // an empty PATH entry means the current directory
+        full_path.assign(dir, len);
+        if (full_path.empty()) full_path = ".";
+        full_path += '/';
+        full_path += cmd;
+
+        // access() also fails when the file doesn't exist, one syscall per dir
+        if (!access(full_path.c_str(), X_OK)) {
+            return full_path;
+        }
+
+        if (!end) break;
+        dir = end + 1;
+    }
+    return "";
+}
+
+void CommandHash::check_path() {
+    const char* env_p = std::getenv("PATH");
+    const char* current = env_p ? env_p : "";
+
+    // PATH changed since the table was filled -> forget everything
+    if (!path_known || cached_path != current) {
+        table.clear();
+        cached_path = current;
+        path_known = true;
+    }
+}
+
+std::string CommandHash::lookup(const std::string& cmd, bool count_hit) {
+    if (cmd.empty()) return "";
+
+    // paths are never hashed, just check them
+    if (cmd.find('/') != std::string::npos) {
+        return access(cmd.c_str(), X_OK) ? "" : cmd;
+    }
+
+    check_path();
+
+    auto it = table.find(cmd);
+    if (it != table.end()) {
+        // a run trusts the entry, a spawn that finds the file gone removes it. A query (type, command -v)
+        // shows what is on disk now
+        if (count_hit) {
+            it->second.hits++;
+            return it->second.path;
+        }
+        if (!access(it->second.path.c_str(), X_OK)) return it->second.path;
+        table.erase(it);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::string path = find_in_path(cmd, std::getenv("PATH"));
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    if (path.empty()) return "";
+
+    Entry& entry = table[cmd];
+    entry.path = path;
+    entry.hits = count_hit ? 1 : 0;
+    entry.resolve_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    return path;
+}
+
+void CommandHash::add(const std::string& cmd, const std::string& path) {
+    check_path();
+    Entry& entry = table[cmd];
+    entry.path = path;
+    entry.hits = 0;
+    entry.resolve_ns = 0;
+}
+
+bool CommandHash::remove(const std::string& cmd) {
+    return table.erase(cmd) > 0;
+}
+
+const CommandHash::Entry* CommandHash::find(const std::string& cmd) const {
+    auto it = table.find(cmd);
+    return it == table.end() ? nullptr : &it->second;
+}
+
+std::vector<std::pair<std::string, CommandHash::Entry>> CommandHash::entries() const {
+    std::vector<std::pair<std::string, Entry>> result(table.begin(), table.end());
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    return result;
+}
@@ -0,0 +1,44 @@
+#ifndef SHELL_STARTER_CPP_COMMANDHASH_H
+#define SHELL_STARTER_CPP_COMMANDHASH_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// bash-style table of resolved command paths, PATH is only walked on a miss.
+// A hit costs no syscall: entries go when PATH changes, when the owner removes them (the shell's PATH watcher)
+// and when running the hashed path fails with ENOENT.
+class CommandHash {
+public:
+    struct Entry {
+        std::string path;
+        uint64_t hits = 0;
+        uint64_t resolve_ns = 0; // cost of the PATH walk that filled the entry
+    };
+
+    // full path of cmd or "" when it can't be found. count_hit false: a query, a hashed path is checked with access()
+    std::string lookup(const std::string& cmd, bool count_hit = true);
+
+    void add(const std::string& cmd, const std::string& path);
+    bool remove(const std::string& cmd);
+    void clear() { table.clear(); }
+    bool empty() const { return table.empty(); }
+    const Entry* find(const std::string& cmd) const;
+
+    // entries sorted by command name
+    std::vector<std::pair<std::string, Entry>> entries() const;
+
+    static std::string find_in_path(const std::string& cmd, const char* path_env);
+
+private:
+    std::unordered_map<std::string, Entry> table;
+    std::string cached_path; // PATH the table was filled with
+    bool path_known = false;
+
+    void check_path();
+};
+
+
+#endif //SHELL_STARTER_CPP_COMMANDHASH_H
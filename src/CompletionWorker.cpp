@@ -0,0 +1,108 @@
+#include "CompletionWorker.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// Completion on a thread of its own, results signalled through an eventfd
+
+CompletionWorker::~CompletionWorker() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+        current = 0;
+    }
+    wake.notify_one();
+    if (thread.joinable()) thread.join();
+    if (event_fd >= 0) close(event_fd);
+}
+
+int CompletionWorker::fd() {
+    if (event_fd < 0) event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    return event_fd;
+}
+
+uint64_t CompletionWorker::start(Walk walk) {
+    fd();
+    uint64_t request;
+    {
+        std::lock_guard lock(mutex);
+        request = ++last_request;
+        current = request;
+        next = std::move(walk);
+        arrived.clear();
+        finished = false;
+        partial = false;
+        if (!thread.joinable()) thread = std::thread([this]() { run(); });
+    }
+    wake.notify_one();
+    return request;
+}
+
+void CompletionWorker::cancel() {
+    std::lock_guard lock(mutex);
+    current = 0;
+    next = nullptr;
+    arrived.clear();
+    finished = false;
+    partial = false;
+}
+
+CompletionWorker::Batch CompletionWorker::take() {
+    if (event_fd >= 0) {
+        uint64_t count;
+        (void) !read(event_fd, &count, sizeof(count));
+    }
+
+    Batch batch;
+    std::lock_guard lock(mutex);
+    batch.request = current;
+    batch.matches.swap(arrived);
+    batch.done = finished;
+    batch.partial = partial;
+    finished = false;
+    partial = false;
+    return batch;
+}
+
+void CompletionWorker::hand_over(uint64_t request, std::vector<Match>& found, bool done, bool incomplete) {
+    {
+        std::lock_guard lock(mutex);
+        if (current != request) return;
+        if (arrived.empty()) arrived.swap(found);
+        else std::move(found.begin(), found.end(), std::back_inserter(arrived));
+        finished = done;
+        partial = incomplete;
+    }
+    found.clear();
+
+    uint64_t one = 1;
+    (void) !write(event_fd, &one, sizeof(one));
+}
+
+void CompletionWorker::run() {
+    while (true) {
+        Walk walk;
+        uint64_t request;
+        {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [this]() { return stopping || next; });
+            if (stopping) return;
+            walk = std::move(next);
+            next = nullptr;
+            request = current;
+            running = request;
+        }
+
+        std::vector<Match> found;
+        Emit emit = [&](std::string_view text, bool directory) {
+            if (current.load(std::memory_order_relaxed) != request) return false;
+            found.push_back({std::string(text), directory});
+            if (found.size() == BATCH) hand_over(request, found, false);
+            return true;
+        };
+        bool whole = walk(emit);
+        hand_over(request, found, true, !whole);
+    }
+}
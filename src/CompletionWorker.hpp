@@ -0,0 +1,73 @@
+#ifndef SHELL_STARTER_CPP_COMPLETIONWORKER_H
+#define SHELL_STARTER_CPP_COMPLETIONWORKER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Runs completion walks off the line editor's thread.
+// One request at a time: starting a new one or cancel() makes the running walk stop at its next match.
+// Matches come back in batches, fd() turns readable whenever take() has something.
+class CompletionWorker {
+public:
+    struct Match {
+        std::string text;
+        bool directory = false;
+    };
+
+    // called by a walk for every match, false once the request is cancelled
+    using Emit = std::function<bool(std::string_view text, bool directory)>;
+    // returns false when it could only look at part of the candidates (PATH still being scanned)
+    using Walk = std::function<bool(const Emit& emit)>;
+
+    struct Batch {
+        uint64_t request = 0; // 0: nothing running
+        std::vector<Match> matches;
+        bool done = false; // the walk returned, this is the last batch
+        bool partial = false; // with done: the walk's matches are only some of them
+    };
+
+    CompletionWorker() = default;
+    ~CompletionWorker();
+    CompletionWorker(const CompletionWorker&) = delete;
+    CompletionWorker& operator=(const CompletionWorker&) = delete;
+
+    // runs walk on the worker thread (started on first use), returns the request's id
+    uint64_t start(Walk walk);
+    void cancel();
+    // for a walk, on the worker thread: its request was cancelled or replaced, nobody wants its matches anymore
+    bool cancelled() const { return current.load(std::memory_order_relaxed) != running.load(std::memory_order_relaxed); }
+    // eventfd, created on first use
+    int fd();
+    // what the current request found since the last call
+    Batch take();
+
+private:
+    static constexpr size_t BATCH = 256; // matches handed over at once
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    Walk next; // waiting for the thread
+    uint64_t last_request = 0;
+    std::atomic<uint64_t> current{0}; // request whose matches are wanted, 0 after cancel()
+    std::atomic<uint64_t> running{0}; // request the worker thread is walking
+    std::vector<Match> arrived;
+    bool finished = false;
+    bool partial = false;
+    bool stopping = false;
+    int event_fd = -1;
+
+    void run();
+    // moves found into arrived if request is still the current one; incomplete goes with done, see Batch::partial
+    void hand_over(uint64_t request, std::vector<Match>& found, bool done, bool incomplete = false);
+};
+
+
+#endif //SHELL_STARTER_CPP_COMPLETIONWORKER_H
@@ -0,0 +1,139 @@
+#include "DirCache.hpp"
+
+#include <algorithm>
+#include <ctime>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// Directory listing cache, one stat() per Tab on a hit
+
+namespace {
+    int64_t mtime_of(const struct stat& st) {
+        return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    }
+
+    int64_t realtime_ns() {
+        timespec ts{};
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+}
+
+DirCache::Listing* DirCache::get(const std::string& dir) {
+    struct stat st{};
+    if (stat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) return nullptr;
+
+    auto it = std::find_if(listings.begin(), listings.end(), [&dir](const Listing& l) { return l.path == dir; });
+    if (it != listings.end() && it->trusted && it->dev == st.st_dev && it->ino == st.st_ino &&
+        it->mtime_ns == mtime_of(st)) {
+        it->last_used = ++use_clock;
+        return &*it;
+    }
+
+    if (it == listings.end()) {
+        if (listings.size() >= MAX_LISTINGS) {
+            it = std::min_element(listings.begin(), listings.end(),
+                                  [](const Listing& a, const Listing& b) { return a.last_used < b.last_used; });
+        } else {
+            it = listings.emplace(listings.end());
+        }
+    }
+
+    Listing& listing = *it;
+    listing = Listing{};
+    listing.path = dir;
+    listing.dev = st.st_dev;
+    listing.ino = st.st_ino;
+    listing.mtime_ns = mtime_of(st);
+    // a change within the filesystem's timestamp granularity of this read would keep the same mtime (racy git)
+    listing.trusted = realtime_ns() - listing.mtime_ns > 2000000000LL;
+    listing.last_used = ++use_clock;
+    if (!read_listing(listing)) {
+        listing.path.clear();
+        listing.last_used = 0;
+        return nullptr;
+    }
+    read_count++;
+    return &listing;
+}
+
+bool DirCache::read_listing(Listing& listing) {
+    if (!listing.read(listing.path.c_str())) return false;
+
+    std::sort(listing.entries.begin(), listing.entries.end(), [&listing](const Entry& a, const Entry& b) {
+        return listing.name(a) < listing.name(b);
+    });
+    return true;
+}
+
+std::pair<size_t, size_t> DirCache::range(const Listing& listing, std::string_view prefix) {
+    auto first = std::lower_bound(listing.entries.begin(), listing.entries.end(), prefix,
+                                  [&listing](const Entry& e, std::string_view p) { return listing.name(e) < p; });
+    auto last = listing.entries.end();
+    if (!prefix.empty()) {
+        // names sharing a prefix are contiguous, so a second binary search bounds the range
+        std::string upper(prefix);
+        while (!upper.empty() && static_cast<unsigned char>(upper.back()) == 0xFF) upper.pop_back();
+        if (!upper.empty()) {
+            upper.back() = static_cast<char>(static_cast<unsigned char>(upper.back()) + 1);
+            last = std::lower_bound(first, listing.entries.end(), std::string_view(upper),
+                                    [&listing](const Entry& e, std::string_view p) { return listing.name(e) < p; });
+        }
+    }
+    return {static_cast<size_t>(first - listing.entries.begin()), static_cast<size_t>(last - listing.entries.begin())};
+}
+
+bool DirCache::hidden(std::string_view name, std::string_view prefix) {
+    return name.starts_with('.') && !prefix.starts_with('.');
+}
+
+bool DirCache::is_directory(const Listing& listing, Entry& entry) {
+    if (entry.type == DT_LNK || entry.type == DT_UNKNOWN) {
+        // follow the link once, remember what it pointed to
+        std::string path = listing.path + "/" + std::string(listing.name(entry));
+        struct stat st{};
+        entry.type = stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+    }
+    return entry.type == DT_DIR;
+}
+
+size_t DirCache::for_each(const std::string& dir, std::string_view prefix,
+                          const std::function<bool(const Match&)>& visit) {
+    Listing* listing = get(dir);
+    if (!listing) return 0;
+
+    auto [first, last] = range(*listing, prefix);
+    size_t count = 0;
+    bool visiting = true;
+    for (size_t i = first; i < last; ++i) {
+        Entry& entry = listing->entries[i];
+        std::string_view entry_name = listing->name(entry);
+        if (hidden(entry_name, prefix)) continue;
+        count++;
+        if (visiting) visiting = visit({entry_name, is_directory(*listing, entry)});
+    }
+    return count;
+}
+
+std::string DirCache::common_prefix(const std::string& dir, std::string_view prefix) {
+    Listing* listing = get(dir);
+    if (!listing) return std::string(prefix);
+
+    auto [first, last] = range(*listing, prefix);
+    std::string_view common;
+    bool any = false;
+    for (size_t i = first; i < last; ++i) {
+        std::string_view entry_name = listing->name(listing->entries[i]);
+        if (hidden(entry_name, prefix)) continue;
+        if (!any) {
+            common = entry_name;
+            any = true;
+            continue;
+        }
+        size_t n = 0;
+        while (n < common.size() && n < entry_name.size() && common[n] == entry_name[n]) n++;
+        common = common.substr(0, n);
+        if (common.size() == prefix.size()) break;
+    }
+    return any ? std::string(common) : std::string(prefix);
+}
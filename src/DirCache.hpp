@@ -0,0 +1,62 @@
+#ifndef SHELL_STARTER_CPP_DIRCACHE_H
+#define SHELL_STARTER_CPP_DIRCACHE_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "DirListing.hpp"
+
+// Directory listings for filename completion.
+// A directory is read once with getdents64 into one sorted block of names, later Tabs only stat() it and reuse the
+// listing until its mtime changes. Listings of recently used directories are kept, the oldest is dropped.
+class DirCache {
+public:
+    struct Match {
+        std::string_view name;
+        bool directory; // symlinks to directories count as directories
+    };
+
+    // Calls visit for every entry of dir starting with prefix, in byte order, until it returns false.
+    // Dot files only match a prefix starting with '.', "." and ".." never do.
+    // Returns how many entries match (visited or not), 0 when dir can't be read.
+    size_t for_each(const std::string& dir, std::string_view prefix, const std::function<bool(const Match&)>& visit);
+
+    // longest prefix shared by every match of prefix in dir, prefix itself when there are none
+    std::string common_prefix(const std::string& dir, std::string_view prefix);
+
+    // directories read from disk so far, cache hits don't count
+    size_t reads() const { return read_count; }
+
+private:
+    using Entry = DirListing::Entry; // DT_LNK / DT_UNKNOWN resolved to DT_DIR / DT_REG on first use
+
+    // entries sorted by name
+    struct Listing : DirListing {
+        std::string path;
+        uint64_t dev = 0;
+        uint64_t ino = 0;
+        int64_t mtime_ns = 0;
+        bool trusted = false; // false when mtime was too recent to tell a later change from this state
+        uint64_t last_used = 0;
+    };
+
+    static constexpr size_t MAX_LISTINGS = 32;
+
+    std::vector<Listing> listings;
+    uint64_t use_clock = 0;
+    size_t read_count = 0;
+
+    // current listing of dir, nullptr when it can't be read
+    Listing* get(const std::string& dir);
+    static bool read_listing(Listing& listing);
+    // entries starting with prefix, as [first, last)
+    static std::pair<size_t, size_t> range(const Listing& listing, std::string_view prefix);
+    static bool hidden(std::string_view name, std::string_view prefix);
+    static bool is_directory(const Listing& listing, Entry& entry);
+};
+
+
+#endif //SHELL_STARTER_CPP_DIRCACHE_H
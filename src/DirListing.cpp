@@ -0,0 +1,36 @@
+#include "DirListing.hpp"
+
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// getdents64 directory reader
+
+namespace {
+    constexpr size_t GETDENTS_BUFFER = 256 << 10; // large directories are read in few calls
+}
+
+bool DirListing::read(const char* path) {
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    // one buffer per thread, glob walks read many directories on the pool
+    thread_local std::vector<char> buf(GETDENTS_BUFFER);
+    while (true) {
+        ssize_t n = getdents64(fd, buf.data(), buf.size());
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        for (ssize_t at = 0; at < n;) {
+            auto* d = reinterpret_cast<dirent64*>(buf.data() + at);
+            at += d->d_reclen;
+            std::string_view entry_name(d->d_name);
+            if (entry_name == "." || entry_name == "..") continue;
+            entries.push_back({static_cast<uint32_t>(names.size()), static_cast<uint32_t>(entry_name.size()),
+                               d->d_type});
+            names += entry_name;
+        }
+    }
+    close(fd);
+    return true;
+}
@@ -0,0 +1,28 @@
+#ifndef SHELL_STARTER_CPP_DIRLISTING_H
+#define SHELL_STARTER_CPP_DIRLISTING_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A directory's entries as getdents64 returns them, in directory order, names back to back in one block.
+// Shared by globbing and the completion listing cache; d_type comes along so callers rarely need a stat().
+struct DirListing {
+    struct Entry {
+        uint32_t offset; // into names
+        uint32_t length;
+        unsigned char type; // d_type, may be DT_LNK / DT_UNKNOWN
+    };
+
+    std::string names;
+    std::vector<Entry> entries;
+
+    std::string_view name(const Entry& e) const { return {names.data() + e.offset, e.length}; }
+
+    // appends every entry of path except "." and "..", false when it can't be opened
+    bool read(const char* path);
+};
+
+
+#endif //SHELL_STARTER_CPP_DIRLISTING_H
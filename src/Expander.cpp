@@ -0,0 +1,305 @@
+#include "Expander.hpp"
+
+#include "Lexer.hpp"
+
+// $ expansion, command substitution, field splitting, quote removal and globbing in one pass over the raw word
+
+namespace {
+    bool name_char(char c, bool first) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || (!first && c >= '0' && c <= '9');
+    }
+}
+
+bool Expander::fields(std::string_view raw, std::vector<std::string>& out) {
+    return expand(raw, Split, out);
+}
+
+bool Expander::string(std::string_view raw, std::string& out) {
+    std::vector<std::string> one;
+    if (!expand(raw, Whole, one)) return false;
+    out = one.empty() ? std::string() : std::move(one[0]);
+    return true;
+}
+
+bool Expander::heredoc(std::string_view body, std::string& out) {
+    std::vector<std::string> one;
+    if (!expand(body, HereDoc, one)) return false;
+    out = one.empty() ? std::string() : std::move(one[0]);
+    return true;
+}
+
+bool Expander::lookup(std::string_view name, std::string& value) const {
+    if (name == "?") {
+        value = std::to_string(specials.status);
+    } else if (name == "$") {
+        value = std::to_string(specials.shell_pid);
+    } else if (name == "!") {
+        if (specials.last_background == 0) return false;
+        value = std::to_string(specials.last_background);
+    } else if (name == "#") {
+        value = "0";
+    } else if (name == "0") {
+        value = "shell";
+    } else if (name.size() == 1 && (name[0] == '@' || name[0] == '*' || (name[0] >= '1' && name[0] <= '9'))) {
+        return false; // no positional parameters
+    } else {
+        const std::string* v = vars.get(name);
+        if (!v) return false;
+        value = *v;
+    }
+    return true;
+}
+
+bool Expander::parameter(std::string_view raw, size_t& i, std::string& value, bool& literal) {
+    literal = false;
+    size_t start = i + 1;
+    if (start >= raw.size()) {
+        literal = true;
+        return true;
+    }
+
+    char c = raw[start];
+    if (c == '(') {
+        size_t close = Lexer::closing_bracket(raw, start);
+        if (close == std::string_view::npos) {
+            error_message = std::string(raw.substr(i)) + ": unterminated command substitution";
+            return false;
+        }
+        i = close;
+        return run(raw.substr(start + 1, close - start - 1), value);
+    }
+    if (c != '{') {
+        size_t end = start;
+        if (name_char(c, true)) {
+            while (end < raw.size() && name_char(raw[end], false)) end++;
+        } else if (std::string_view("?$!#@*0123456789").find(c) != std::string_view::npos) {
+            end = start + 1;
+        } else {
+            literal = true; // a lone $
+            return true;
+        }
+        if (!lookup(raw.substr(start, end - start), value)) value.clear();
+        i = end - 1;
+        return true;
+    }
+
+    size_t close = Lexer::closing_bracket(raw, start);
+    if (close == std::string_view::npos) {
+        error_message = std::string(raw.substr(i)) + ": bad substitution";
+        return false;
+    }
+    std::string_view inside = raw.substr(start + 1, close - start - 1);
+    i = close;
+    auto bad = [&]() {
+        error_message = "${" + std::string(inside) + "}: bad substitution";
+        return false;
+    };
+
+    // ${#name}: length
+    bool length = inside.size() > 1 && inside[0] == '#';
+    if (length) inside.remove_prefix(1);
+
+    size_t name_end = 0;
+    if (!inside.empty() && name_char(inside[0], true)) {
+        while (name_end < inside.size() && name_char(inside[name_end], false)) name_end++;
+    } else if (!inside.empty() && std::string_view("?$!#@*0123456789").find(inside[0]) != std::string_view::npos) {
+        name_end = 1;
+    }
+    if (name_end == 0) return bad();
+
+    std::string_view name = inside.substr(0, name_end);
+    std::string_view op = inside.substr(name_end);
+    bool is_set = lookup(name, value);
+    if (!is_set) value.clear();
+
+    if (length) {
+        if (!op.empty()) return bad();
+        value = std::to_string(value.size());
+        return true;
+    }
+    if (op.empty()) return true;
+
+    // with ':' an empty value counts as unset
+    bool colon = op[0] == ':';
+    if (colon) op.remove_prefix(1);
+    if (op.empty() || std::string_view("-=+?").find(op[0]) == std::string_view::npos) return bad();
+    char kind = op[0];
+    std::string_view word = op.substr(1);
+    bool missing = !is_set || (colon && value.empty());
+
+    auto word_value = [&](std::string& out) { return string(word, out); };
+    switch (kind) {
+        case '-':
+            if (missing && !word_value(value)) return false;
+            break;
+        case '=':
+            if (missing) {
+                if (!Variables::valid_name(name)) {
+                    error_message = std::string(name) + ": cannot assign in this way";
+                    return false;
+                }
+                if (!word_value(value)) return false;
+                vars.set(name, value);
+            }
+            break;
+        case '+':
+            if (missing) value.clear();
+            else if (!word_value(value)) return false;
+            break;
+        case '?':
+            if (missing) {
+                std::string message;
+                if (!word_value(message)) return false;
+                error_message = std::string(name) + ": " + (message.empty() ? "parameter null or not set" : message);
+                return false;
+            }
+            break;
+    }
+    return true;
+}
+
+bool Expander::run(std::string_view command, std::string& value) {
+    if (!substitute) {
+        error_message = "command substitution is not available here";
+        return false;
+    }
+    error_message.clear(); // substitute reports its own errors
+    return substitute(command, value);
+}
+
+bool Expander::expand(std::string_view raw, Mode mode, std::vector<std::string>& out) {
+    std::string field;
+    bool started = false; // field exists, even if empty ("")
+    bool split_on_blank = false; // the last field was ended by IFS whitespace, a ':' right after doesn't add one
+    bool in_double = false;
+    const std::string* ifs_var = mode == Split ? vars.get("IFS") : nullptr;
+    std::string_view ifs = ifs_var ? std::string_view(*ifs_var) : std::string_view(" \t\n");
+
+    // the field again as a glob pattern: quoted pattern characters escaped, wild once an unquoted one shows up
+    bool globbing = mode == Split && glob;
+    std::string pattern;
+    bool wild = false;
+    auto add = [&](std::string_view text, bool quoted) {
+        field += text;
+        if (!globbing) return;
+        for (char c : text) {
+            if (quoted && (c == '*' || c == '?' || c == '[' || c == ']' || c == '\\')) pattern += '\\';
+            pattern += c;
+            wild |= !quoted && (c == '*' || c == '?' || c == '[');
+        }
+    };
+    auto finish = [&]() {
+        std::vector<std::string> paths;
+        if (wild) paths = glob->expand(pattern);
+        if (paths.empty()) out.push_back(std::move(field));
+        else out.insert(out.end(), std::make_move_iterator(paths.begin()), std::make_move_iterator(paths.end()));
+        field.clear();
+        pattern.clear();
+        wild = false;
+    };
+
+    // \<newline> outside single quotes joins lines before anything reads the word: $x\<newline>y is $xy.
+    // Here-doc bodies drop it as they go, a ' is no quote there.
+    std::string joined;
+    if (mode != HereDoc && raw.find("\\\n") != std::string_view::npos) {
+        char quote = '\0';
+        for (size_t i = 0; i < raw.size(); ++i) {
+            char c = raw[i];
+            if (quote == '\'') {
+                if (c == '\'') quote = '\0';
+            } else if (c == '\\' && i + 1 < raw.size()) {
+                if (raw[++i] == '\n') continue;
+                joined += c;
+                c = raw[i];
+            } else if (c == '\'' && !quote) {
+                quote = c;
+            } else if (c == '"') {
+                quote = quote ? '\0' : c;
+            }
+            joined += c;
+        }
+        raw = joined;
+    }
+
+    for (size_t i = 0; i < raw.size(); ++i) {
+        char c = raw[i];
+
+        if (c == '$' || c == '`') {
+            std::string value;
+            bool literal = false;
+            if (c == '`') {
+                // `...`: \ \` and \$ are escapes inside, what is left is the command
+                size_t close = Lexer::closing_backquote(raw, i);
+                if (close == std::string_view::npos) close = raw.size();
+                std::string command;
+                for (size_t k = i + 1; k < close; ++k) {
+                    if (raw[k] == '\\' && k + 1 < close && std::string_view("\\`$").find(raw[k + 1]) != std::string_view::npos) k++;
+                    command += raw[k];
+                }
+                i = close;
+                if (!run(command, value)) return false;
+            } else if (!parameter(raw, i, value, literal)) {
+                return false;
+            }
+            if (literal) {
+                add("$", true);
+                started = true;
+            } else if (mode != Split || in_double) {
+                add(value, true);
+                started = true;
+            } else {
+                // runs of IFS whitespace are one delimiter, any other IFS character always ends a field,
+                // an empty one too (a::b is a, "" and b)
+                for (char v : value) {
+                    if (ifs.find(v) == std::string_view::npos) {
+                        add(std::string_view(&v, 1), false);
+                        started = true;
+                    } else if (v == ' ' || v == '\t' || v == '\n') {
+                        if (started) {
+                            finish();
+                            split_on_blank = true;
+                        }
+                        started = false;
+                    } else {
+                        if (started || !split_on_blank) finish();
+                        started = false;
+                        split_on_blank = false;
+                    }
+                }
+            }
+            continue;
+        }
+
+        started = true;
+        if (mode == HereDoc) {
+            if (c == '\\' && i + 1 < raw.size() && std::string_view("$`\\\n").find(raw[i + 1]) != std::string_view::npos) {
+                if (raw[++i] != '\n') field += raw[i];
+            } else {
+                field += c;
+            }
+        } else if (in_double) {
+            if (c == '"') {
+                in_double = false;
+            } else if (c == '\\' && i + 1 < raw.size() &&
+                       std::string_view("$`\"\\").find(raw[i + 1]) != std::string_view::npos) {
+                add(raw.substr(++i, 1), true);
+            } else {
+                add(raw.substr(i, 1), true);
+            }
+        } else if (c == '\'') {
+            size_t close = raw.find('\'', i + 1);
+            if (close == std::string_view::npos) close = raw.size();
+            add(raw.substr(i + 1, close - i - 1), true);
+            i = close;
+        } else if (c == '"') {
+            in_double = true;
+        } else if (c == '\\' && i + 1 < raw.size()) {
+            add(raw.substr(++i, 1), true);
+        } else {
+            add(raw.substr(i, 1), false);
+        }
+    }
+
+    if (started || mode != Split) finish();
+    return true;
+}
@@ -0,0 +1,65 @@
+#ifndef SHELL_STARTER_CPP_EXPANDER_H
+#define SHELL_STARTER_CPP_EXPANDER_H
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <vector>
+
+#include "Glob.hpp"
+#include "Variables.hpp"
+
+// Parameter expansion, command substitution and quote removal of a word as written (Word::raw), right before its
+// command runs.
+//   $name ${name} $? $$ $! $# $0-$9
+//   ${#name} ${name:-word} ${name-word} ${name:=word} ${name=word} ${name:+word} ${name+word} ${name:?word}
+//   $(command) `command`
+//   * ? [...] **  (pathname expansion, through Glob)
+// Unquoted expansions are split into fields on IFS, inside "" they stay one field, '' keeps every $ as it is.
+// A field with an unquoted * ? or [ becomes the paths it matches, it stays as it is when there are none.
+class Expander {
+public:
+    struct Specials {
+        int status = 0;            // $?
+        pid_t shell_pid = 0;       // $$
+        pid_t last_background = 0; // $!, 0 while there was none
+    };
+
+    // runs command, output gets what it wrote with the trailing newlines removed. False on an error (reported).
+    using Substitute = std::function<bool(std::string_view command, std::string& output)>;
+
+    // glob nullptr: no pathname expansion (set -o noglob)
+    Expander(Variables& vars, const Specials& specials, Substitute substitute = {}, Glob* glob = nullptr)
+        : vars(vars), specials(specials), substitute(std::move(substitute)), glob(glob) {}
+
+    // the fields raw expands to, none for an unquoted expansion that came out empty.
+    // False on an error (${name:?}, bad substitution), error() says what went wrong (empty: already reported).
+    bool fields(std::string_view raw, std::vector<std::string>& out);
+    // one string, nothing split: assignment values, redirection targets
+    bool string(std::string_view raw, std::string& out);
+    // here-doc body: quotes are plain characters, only $ and \ before $ ` \ or a newline are special
+    bool heredoc(std::string_view body, std::string& out);
+
+    const std::string& error() const { return error_message; }
+
+private:
+    enum Mode { Split, Whole, HereDoc };
+
+    Variables& vars;
+    Specials specials;
+    Substitute substitute;
+    Glob* glob;
+    std::string error_message;
+
+    bool expand(std::string_view raw, Mode mode, std::vector<std::string>& out);
+    // the parameter or $(command) at raw[i] == '$', i ends on its last character. False on an error.
+    bool parameter(std::string_view raw, size_t& i, std::string& value, bool& literal);
+    // output of command, false on an error
+    bool run(std::string_view command, std::string& value);
+    // value of name, false when it is unset
+    bool lookup(std::string_view name, std::string& value) const;
+};
+
+
+#endif //SHELL_STARTER_CPP_EXPANDER_H
@@ -0,0 +1,765 @@
+#include "FastIO.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// cat / head / tail / wc / tee, moving data between fds without the shell forking
+
+namespace fastio {
+    namespace {
+        constexpr size_t CHUNK = 1 << 20;         // per splice / copy call
+        constexpr size_t READ_BUFFER = 256 << 10; // fallback read() size
+
+        volatile std::sig_atomic_t got_sigint = 0;
+        std::atomic<int> scopes{0};
+        struct sigaction shell_sigint{};
+
+        void on_sigint(int) {
+            got_sigint = 1;
+        }
+
+        bool write_all(int fd, const char* data, size_t size) {
+            while (size > 0) {
+                ssize_t n = write(fd, data, size);
+                if (n < 0 && errno == EINTR && !interrupted()) continue;
+                if (n <= 0) return false;
+                data += n;
+                size -= n;
+            }
+            return true;
+        }
+
+        bool write_all(int fd, std::string_view text) {
+            return write_all(fd, text.data(), text.size());
+        }
+
+        // "name: what: reason"
+        void report(Io io, std::string_view name, std::string_view what, int err) {
+            if (err == EPIPE || interrupted()) return; // the reader went away / Ctrl-C, nothing worth saying
+            std::string line(name);
+            if (!what.empty()) {
+                line += ": ";
+                line += what;
+            }
+            line += ": ";
+            line += err ? std::strerror(err) : "invalid argument";
+            line += '\n';
+            write_all(io.err, line);
+        }
+
+        int failure_status(int err) {
+            if (interrupted()) return 130;
+            return err == EPIPE ? 141 : 1;
+        }
+
+        // one input operand, "-" is stdin
+        struct Input {
+            int fd = -1;
+            bool owned = false;
+            std::string_view name;
+
+            ~Input() {
+                if (owned) close(fd);
+            }
+        };
+
+        bool open_input(Input& input, const std::string& operand, Io io, std::string_view cmd) {
+            input.name = operand;
+            if (operand == "-") {
+                input.fd = io.in;
+                return true;
+            }
+            input.fd = open(operand.c_str(), O_RDONLY | O_CLOEXEC);
+            if (input.fd < 0) {
+                report(io, cmd, operand, errno);
+                return false;
+            }
+            input.owned = true;
+            return true;
+        }
+
+        bool parse_count(std::string_view text, uint64_t& count) {
+            if (text.empty()) return false;
+            uint64_t value = 0;
+            for (char c : text) {
+                if (c < '0' || c > '9') return false;
+                value = value * 10 + (c - '0');
+            }
+            count = value;
+            return true;
+        }
+
+        // read-only view of a regular file from offset to its end, empty for anything else
+        struct Mapping {
+            const char* data = nullptr;
+            size_t size = 0;
+            void* base = MAP_FAILED;
+            size_t length = 0;
+
+            ~Mapping() {
+                if (base != MAP_FAILED) munmap(base, length);
+            }
+
+            bool map(int fd, off_t offset) {
+                struct stat st{};
+                if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= offset) return false;
+                length = st.st_size;
+                base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (base == MAP_FAILED) return false;
+                madvise(base, length, MADV_SEQUENTIAL);
+                data = static_cast<const char*>(base) + offset;
+                size = length - offset;
+                return true;
+            }
+        };
+
+        off_t current_offset(int fd) {
+            off_t at = lseek(fd, 0, SEEK_CUR);
+            return at < 0 ? 0 : at;
+        }
+
+        bool regular_file(int fd, struct stat& st) {
+            return fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+        }
+    }
+
+    bool interrupted() {
+        // a forked stage inherits the flag, without a scope of its own it means nothing there
+        return scopes > 0 && got_sigint != 0;
+    }
+
+    InterruptScope::InterruptScope() {
+        if (scopes++ > 0) return;
+        got_sigint = 0;
+        // no SA_RESTART: a blocked splice / read returns EINTR
+        struct sigaction sa{};
+        sa.sa_handler = on_sigint;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGINT, &sa, &shell_sigint);
+    }
+
+    InterruptScope::~InterruptScope() {
+        if (--scopes > 0) return;
+        sigaction(SIGINT, &shell_sigint, nullptr);
+    }
+
+    bool copy(int in, int out, uint64_t limit) {
+        struct stat in_st{}, out_st{};
+        if (fstat(in, &in_st) != 0 || fstat(out, &out_st) != 0) return false;
+
+        bool in_pipe = S_ISFIFO(in_st.st_mode);
+        bool out_pipe = S_ISFIFO(out_st.st_mode);
+        // /proc style files report size 0 and can only be read()
+        bool in_file = S_ISREG(in_st.st_mode) && in_st.st_size > 0;
+        bool out_append = fcntl(out, F_GETFL) & O_APPEND;
+
+        enum { Splice, CopyRange, SendFile, ReadWrite } method = ReadWrite;
+        if (in_pipe || out_pipe) method = Splice;
+        else if (in_file && S_ISREG(out_st.st_mode) && !out_append) method = CopyRange;
+        else if (in_file && !out_append) method = SendFile;
+
+        uint64_t done = 0;
+        while (done < limit) {
+            if (interrupted()) {
+                errno = EINTR;
+                return false;
+            }
+            size_t want = static_cast<size_t>(std::min<uint64_t>(limit - done, CHUNK));
+            ssize_t n;
+            switch (method) {
+                case Splice:
+                    n = splice(in, nullptr, out, nullptr, want, SPLICE_F_MOVE | SPLICE_F_MORE);
+                    break;
+                case CopyRange:
+                    n = copy_file_range(in, nullptr, out, nullptr, want, 0);
+                    break;
+                case SendFile:
+                    n = sendfile(out, in, nullptr, want);
+                    break;
+                default: {
+                    static thread_local std::vector<char> buffer(READ_BUFFER);
+                    n = read(in, buffer.data(), std::min(want, buffer.size()));
+                    if (n > 0 && !write_all(out, buffer.data(), n)) return false;
+                    break;
+                }
+            }
+
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                // this pair of fds doesn't support the zero-copy call (tty, special files, old kernels)
+                if (method != ReadWrite && (errno == EINVAL || errno == ENOSYS || errno == EXDEV ||
+                                            errno == EOPNOTSUPP || errno == EBADF)) {
+                    method = ReadWrite;
+                    continue;
+                }
+                return false;
+            }
+            if (n == 0) break;
+            done += n;
+        }
+        return true;
+    }
+
+    size_t count_newlines(const char* data, size_t size) {
+        size_t count = 0;
+        size_t i = 0;
+#if defined(__x86_64__)
+        // 64 bytes per step: four compares, one movemask + popcount each
+        const __m128i nl = _mm_set1_epi8('\n');
+        for (; i + 64 <= size; i += 64) {
+            for (int k = 0; k < 4; ++k) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 16 * k));
+                count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)));
+            }
+        }
+#endif
+        for (; i < size; ++i) count += data[i] == '\n';
+        return count;
+    }
+
+#if defined(__x86_64__)
+    namespace {
+        __attribute__((target("avx2"))) size_t count_newlines_avx2(const char* data, size_t size) {
+            size_t count = 0;
+            size_t i = 0;
+            const __m256i nl = _mm256_set1_epi8('\n');
+            // byte counters, folded into count every 255 rounds before they overflow
+            while (i + 32 <= size) {
+                __m256i acc = _mm256_setzero_si256();
+                size_t rounds = std::min<size_t>((size - i) / 32, 255);
+                for (size_t r = 0; r < rounds; ++r, i += 32) {
+                    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+                    acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(v, nl));
+                }
+                __m256i sums = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+                count += _mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1) +
+                         _mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3);
+            }
+            for (; i < size; ++i) count += data[i] == '\n';
+            return count;
+        }
+
+        bool has_avx2() {
+            static const bool avx2 = __builtin_cpu_supports("avx2");
+            return avx2;
+        }
+    }
+#endif
+
+    size_t count_words(const char* data, size_t size, bool& in_word) {
+        size_t count = 0;
+        size_t i = 0;
+#if defined(__x86_64__)
+        // whitespace mask of 16 bytes, a word starts at every non-space byte that follows a space
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i tab = _mm_set1_epi8('\t');
+        const __m128i four = _mm_set1_epi8(4);
+        for (; i + 16 <= size; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            __m128i rel = _mm_sub_epi8(v, tab); // \t \n \v \f \r -> 0..4
+            __m128i ctrl = _mm_cmpeq_epi8(_mm_min_epu8(rel, four), rel);
+            unsigned ws = _mm_movemask_epi8(_mm_or_si128(ctrl, _mm_cmpeq_epi8(v, space)));
+            unsigned prev_ws = ((ws << 1) | (in_word ? 0u : 1u)) & 0xFFFF;
+            count += __builtin_popcount(~ws & prev_ws & 0xFFFF);
+            in_word = !(ws & 0x8000);
+        }
+#endif
+        for (; i < size; ++i) {
+            unsigned char c = data[i];
+            bool ws = c == ' ' || (c >= '\t' && c <= '\r');
+            if (!ws && !in_word) count++;
+            in_word = !ws;
+        }
+        return count;
+    }
+
+    int cat(const std::vector<std::string>& args, Io io) {
+        std::vector<std::string> operands;
+        for (const auto& arg : args) {
+            if (arg.size() > 1 && arg[0] == '-') {
+                report(io, "cat", arg, EINVAL);
+                return 1;
+            }
+            operands.push_back(arg);
+        }
+        if (operands.empty()) operands.emplace_back("-");
+
+        int status = 0;
+        for (const auto& operand : operands) {
+            Input input;
+            if (!open_input(input, operand, io, "cat")) {
+                status = 1;
+                continue;
+            }
+            if (!copy(input.fd, io.out)) {
+                int err = errno;
+                report(io, "cat", operand == "-" ? "write error" : operand, err);
+                return failure_status(err);
+            }
+        }
+        return status;
+    }
+
+    namespace {
+        struct CountOptions {
+            uint64_t count = 10;
+            bool bytes = false;
+            bool from_start = false; // tail +N
+            std::vector<std::string> operands;
+        };
+
+        // -n N, -c N, -nN, -N (and +N for tail). io nullptr: only check, report nothing
+        bool parse_count_options(const std::vector<std::string>& args, CountOptions& opts, const Io* io,
+                                 std::string_view cmd) {
+            for (size_t i = 0; i < args.size(); ++i) {
+                std::string_view arg = args[i];
+                if (arg == "-" || arg.empty() || (arg[0] != '-' && !(arg[0] == '+' && cmd == "tail"))) {
+                    opts.operands.push_back(args[i]);
+                    continue;
+                }
+                std::string_view value;
+                if (arg == "-n" || arg == "-c") {
+                    if (i + 1 >= args.size()) {
+                        if (io) report(*io, cmd, arg, EINVAL);
+                        return false;
+                    }
+                    opts.bytes = arg == "-c";
+                    value = args[++i];
+                } else if (arg.starts_with("-n") || arg.starts_with("-c")) {
+                    opts.bytes = arg[1] == 'c';
+                    value = arg.substr(2);
+                } else {
+                    value = arg.substr(arg[0] == '-' ? 1 : 0); // -N, or +N which keeps the sign
+                }
+
+                if (cmd == "tail" && value.starts_with('+')) {
+                    opts.from_start = true;
+                    value.remove_prefix(1);
+                }
+                if (!parse_count(value, opts.count)) {
+                    if (io) report(*io, cmd, std::string(args[i]), EINVAL);
+                    return false;
+                }
+            }
+            if (opts.operands.empty()) opts.operands.emplace_back("-");
+            return true;
+        }
+
+        void header(Io io, const CountOptions& opts, std::string_view name, bool& first) {
+            if (opts.operands.size() < 2) return;
+            std::string line = first ? "" : "\n";
+            line += "==> ";
+            line += name == "-" ? "standard input" : name;
+            line += " <==\n";
+            write_all(io.out, line);
+            first = false;
+        }
+
+        // offset just past the n-th newline of data, or size
+        size_t after_lines(const char* data, size_t size, uint64_t n) {
+            size_t at = 0;
+            while (n > 0 && at < size) {
+                const void* nl = std::memchr(data + at, '\n', size - at);
+                if (!nl) return size;
+                at = static_cast<const char*>(nl) - data + 1;
+                n--;
+            }
+            return at;
+        }
+
+        // offset where the last n lines of data start
+        size_t last_lines(const char* data, size_t size, uint64_t n) {
+            if (n == 0) return size;
+            size_t end = size;
+            if (end > 0 && data[end - 1] == '\n') end--; // the final newline doesn't start a line
+            while (end > 0) {
+                const void* nl = memrchr(data, '\n', end);
+                if (!nl) return 0;
+                end = static_cast<const char*>(nl) - data;
+                if (--n == 0) return end + 1;
+            }
+            return 0;
+        }
+    }
+
+    int head(const std::vector<std::string>& args, Io io) {
+        CountOptions opts;
+        if (!parse_count_options(args, opts, &io, "head")) return 1;
+
+        int status = 0;
+        bool first = true;
+        for (const auto& operand : opts.operands) {
+            Input input;
+            if (!open_input(input, operand, io, "head")) {
+                status = 1;
+                continue;
+            }
+            header(io, opts, operand, first);
+
+            bool ok = true;
+            if (opts.bytes) {
+                ok = copy(input.fd, io.out, opts.count);
+            } else {
+                off_t start = current_offset(input.fd);
+                Mapping file;
+                if (file.map(input.fd, start)) {
+                    // regular file: find the cut in the mapping, the bytes themselves go fd to fd
+                    size_t cut = after_lines(file.data, file.size, opts.count);
+                    ok = copy(input.fd, io.out, cut);
+                } else {
+                    // pipe / tty: only what is needed is passed on, the rest stays unread
+                    std::vector<char> buffer(READ_BUFFER);
+                    uint64_t left = opts.count;
+                    while (left > 0 && ok) {
+                        ssize_t n = read(input.fd, buffer.data(), buffer.size());
+                        if (n < 0 && errno == EINTR && !interrupted()) continue;
+                        if (n < 0) ok = false;
+                        if (n <= 0) break;
+                        size_t cut = after_lines(buffer.data(), n, left);
+                        left -= count_newlines(buffer.data(), cut);
+                        ok = write_all(io.out, buffer.data(), cut);
+                    }
+                }
+            }
+            if (!ok) {
+                int err = errno;
+                report(io, "head", operand, err);
+                return failure_status(err);
+            }
+        }
+        return status;
+    }
+
+    int tail(const std::vector<std::string>& args, Io io) {
+        CountOptions opts;
+        if (!parse_count_options(args, opts, &io, "tail")) return 1;
+
+        int status = 0;
+        bool first = true;
+        for (const auto& operand : opts.operands) {
+            Input input;
+            if (!open_input(input, operand, io, "tail")) {
+                status = 1;
+                continue;
+            }
+            header(io, opts, operand, first);
+
+            bool ok = true;
+            off_t start = current_offset(input.fd);
+            Mapping file;
+            if (file.map(input.fd, start)) {
+                // regular file: scan from the end, then copy the tail fd to fd
+                size_t from;
+                if (opts.bytes) {
+                    from = opts.from_start ? std::min<uint64_t>(opts.count ? opts.count - 1 : 0, file.size)
+                                           : file.size - std::min<uint64_t>(opts.count, file.size);
+                } else {
+                    from = opts.from_start ? after_lines(file.data, file.size, opts.count ? opts.count - 1 : 0)
+                                           : last_lines(file.data, file.size, opts.count);
+                }
+                ok = lseek(input.fd, start + static_cast<off_t>(from), SEEK_SET) >= 0 && copy(input.fd, io.out);
+            } else if (opts.from_start) {
+                // skip the head of the stream, pass the rest on
+                std::vector<char> buffer(READ_BUFFER);
+                uint64_t skip = opts.count ? opts.count - 1 : 0;
+                while (ok) {
+                    ssize_t n = read(input.fd, buffer.data(), buffer.size());
+                    if (n < 0 && errno == EINTR && !interrupted()) continue;
+                    if (n < 0) ok = false;
+                    if (n <= 0) break;
+                    size_t cut;
+                    if (opts.bytes) {
+                        cut = std::min<uint64_t>(skip, n);
+                        skip -= cut;
+                    } else {
+                        cut = after_lines(buffer.data(), n, skip);
+                        skip -= std::min<uint64_t>(skip, count_newlines(buffer.data(), cut));
+                    }
+                    ok = write_all(io.out, buffer.data() + cut, n - cut);
+                    if (ok && skip == 0) {
+                        ok = copy(input.fd, io.out);
+                        break;
+                    }
+                }
+            } else {
+                // pipe: keep only the last lines / bytes in memory
+                std::string kept;
+                std::vector<char> buffer(READ_BUFFER);
+                while (ok) {
+                    ssize_t n = read(input.fd, buffer.data(), buffer.size());
+                    if (n < 0 && errno == EINTR && !interrupted()) continue;
+                    if (n < 0) ok = false;
+                    if (n <= 0) break;
+                    kept.append(buffer.data(), n);
+                    if (kept.size() > 4 * READ_BUFFER) {
+                        size_t from = opts.bytes ? kept.size() - std::min<uint64_t>(opts.count, kept.size())
+                                                 : last_lines(kept.data(), kept.size(), opts.count);
+                        kept.erase(0, from);
+                    }
+                }
+                size_t from = opts.bytes ? kept.size() - std::min<uint64_t>(opts.count, kept.size())
+                                         : last_lines(kept.data(), kept.size(), opts.count);
+                ok = ok && write_all(io.out, kept.data() + from, kept.size() - from);
+            }
+            if (!ok) {
+                int err = errno;
+                report(io, "tail", operand, err);
+                return failure_status(err);
+            }
+        }
+        return status;
+    }
+
+    int wc(const std::vector<std::string>& args, Io io) {
+        bool lines = false, words = false, bytes = false;
+        std::vector<std::string> operands;
+        for (const auto& arg : args) {
+            if (arg.size() > 1 && arg[0] == '-') {
+                for (char c : std::string_view(arg).substr(1)) {
+                    if (c == 'l') lines = true;
+                    else if (c == 'w') words = true;
+                    else if (c == 'c') bytes = true;
+                    else {
+                        report(io, "wc", arg, EINVAL);
+                        return 1;
+                    }
+                }
+            } else {
+                operands.push_back(arg);
+            }
+        }
+        if (!lines && !words && !bytes) lines = words = bytes = true;
+        bool named = !operands.empty();
+        if (!named) operands.emplace_back("-");
+
+        struct Counts {
+            uint64_t lines = 0, words = 0, bytes = 0;
+        };
+        std::vector<std::pair<Counts, std::string_view>> results;
+        Counts total;
+        bool all_regular = true;
+        int status = 0;
+
+        for (const auto& operand : operands) {
+            Input input;
+            if (!open_input(input, operand, io, "wc")) {
+                status = 1;
+                continue;
+            }
+
+            Counts counts;
+            struct stat st{};
+            bool regular = regular_file(input.fd, st) && st.st_size > 0;
+            all_regular &= regular;
+            off_t start = current_offset(input.fd);
+            Mapping file;
+            bool ok = true;
+            bool in_word = false;
+
+            auto count = [&](const char* data, size_t size) {
+#if defined(__x86_64__)
+                if (lines) counts.lines += has_avx2() ? count_newlines_avx2(data, size) : count_newlines(data, size);
+#else
+                if (lines) counts.lines += count_newlines(data, size);
+#endif
+                if (words) counts.words += count_words(data, size, in_word);
+                counts.bytes += size;
+            };
+
+            if (regular && !lines && !words) {
+                // the size is all that was asked for, nothing is read
+                counts.bytes = st.st_size > start ? st.st_size - start : 0;
+            } else if (regular && file.map(input.fd, start)) {
+                for (size_t at = 0; at < file.size && !interrupted(); at += CHUNK) {
+                    count(file.data + at, std::min(CHUNK, file.size - at));
+                }
+                ok = !interrupted();
+            } else {
+                std::vector<char> buffer(READ_BUFFER);
+                while (true) {
+                    ssize_t n = read(input.fd, buffer.data(), buffer.size());
+                    if (n < 0 && errno == EINTR && !interrupted()) continue;
+                    if (n < 0) ok = false;
+                    if (n <= 0) break;
+                    count(buffer.data(), n);
+                }
+                ok = ok && !interrupted(); // the writer stopped because of it, the counts are short
+            }
+            if (!ok) {
+                int err = interrupted() ? EINTR : errno;
+                report(io, "wc", operand, err);
+                return failure_status(err);
+            }
+
+            total.lines += counts.lines;
+            total.words += counts.words;
+            total.bytes += counts.bytes;
+            results.emplace_back(counts, named ? std::string_view(operand) : std::string_view());
+        }
+        if (results.size() > 1) results.emplace_back(total, "total");
+
+        // coreutils layout: one column width for every number, 7 when a pipe's size wasn't known ahead
+        int shown = lines + words + bytes;
+        size_t width = 1;
+        if (shown > 1 || results.size() > 1) {
+            width = all_regular ? std::to_string(std::max({total.lines, total.words, total.bytes})).size() : 7;
+        }
+
+        std::string out;
+        for (const auto& [counts, name] : results) {
+            bool first_col = true;
+            auto column = [&](uint64_t value) {
+                std::string number = std::to_string(value);
+                if (!first_col) out += ' ';
+                if (number.size() < width) out.append(width - number.size(), ' ');
+                out += number;
+                first_col = false;
+            };
+            if (lines) column(counts.lines);
+            if (words) column(counts.words);
+            if (bytes) column(counts.bytes);
+            if (!name.empty()) {
+                out += ' ';
+                out += name;
+            }
+            out += '\n';
+        }
+        if (!write_all(io.out, out)) return failure_status(errno);
+        return status;
+    }
+
+    int tee(const std::vector<std::string>& args, Io io) {
+        bool append = false;
+        std::vector<int> files;
+        int status = 0;
+        for (const auto& arg : args) {
+            if (arg == "-a") {
+                append = true;
+                continue;
+            }
+            int fd = open(arg.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC), 0644);
+            if (fd < 0) {
+                report(io, "tee", arg, errno);
+                status = 1;
+                continue;
+            }
+            files.push_back(fd);
+        }
+
+        auto close_files = [&files]() {
+            for (int fd : files) close(fd);
+        };
+
+        struct stat in_st{}, out_st{};
+        bool pipes = fstat(io.in, &in_st) == 0 && fstat(io.out, &out_st) == 0 && S_ISFIFO(in_st.st_mode) &&
+                     S_ISFIFO(out_st.st_mode) && files.size() <= 1;
+        int sink = files.empty() ? open("/dev/null", O_WRONLY | O_CLOEXEC) : files[0];
+
+        bool ok = true;
+        if (pipes && sink >= 0) {
+            // tee(2) duplicates the pipe's pages into stdout, splice then consumes them into the file
+            while (ok && !interrupted()) {
+                ssize_t n = ::tee(io.in, io.out, CHUNK, 0);
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0 && errno == EINVAL) break; // not supported here, fall back below
+                if (n < 0) ok = false;
+                if (n <= 0) {
+                    pipes = n < 0;
+                    break;
+                }
+                for (ssize_t moved = 0; moved < n && ok;) {
+                    ssize_t m = splice(io.in, nullptr, sink, nullptr, n - moved, SPLICE_F_MOVE);
+                    if (m < 0 && errno == EINTR) continue;
+                    if (m <= 0) ok = false;
+                    else moved += m;
+                }
+            }
+            if (!files.empty() || sink < 0) sink = -1;
+            else close(sink);
+            if (ok && !interrupted() && !pipes) {
+                close_files();
+                return status;
+            }
+        } else if (files.empty() && sink >= 0) {
+            close(sink);
+        }
+
+        // plain loop: read once, write everywhere
+        std::vector<char> buffer(READ_BUFFER);
+        while (ok) {
+            ssize_t n = read(io.in, buffer.data(), buffer.size());
+            if (n < 0 && errno == EINTR && !interrupted()) continue;
+            if (n < 0) ok = false;
+            if (n <= 0) break;
+            ok = write_all(io.out, buffer.data(), n);
+            for (int fd : files) {
+                if (!write_all(fd, buffer.data(), n)) status = 1;
+            }
+        }
+
+        int err = errno;
+        close_files();
+        if (!ok) {
+            report(io, "tee", "", err);
+            return failure_status(err);
+        }
+        return status;
+    }
+
+    bool uses_stdin(std::string_view name, const std::vector<std::string>& args) {
+        if (name == "tee") return true;
+        bool takes_value = name == "head" || name == "tail";
+        for (size_t i = 0; i < args.size(); ++i) {
+            std::string_view arg = args[i];
+            if (arg == "-") return true;
+            if (takes_value && (arg == "-n" || arg == "-c")) {
+                i++;
+            } else if (arg.empty() || (arg[0] != '-' && !(arg[0] == '+' && name == "tail"))) {
+                return false; // a file operand, stdin is only read for "-"
+            }
+        }
+        return true;
+    }
+
+    bool supports(std::string_view name, const std::vector<std::string>& args) {
+        auto option = [](const std::string& arg) { return arg.size() > 1 && arg[0] == '-'; };
+        if (name == "head" || name == "tail") {
+            CountOptions opts;
+            return parse_count_options(args, opts, nullptr, name);
+        }
+        for (const auto& arg : args) {
+            if (!option(arg)) continue;
+            // cat: no options at all, tee: -a, wc: -l -w -c (-m counts characters, the program does that)
+            if (name == "cat") return false;
+            if (name == "tee" && arg != "-a") return false;
+            if (name == "wc" && arg.find_first_not_of("lwc", 1) != std::string::npos) return false;
+        }
+        return true;
+    }
+
+    Builtin find(std::string_view name) {
+        if (name == "cat") return cat;
+        if (name == "head") return head;
+        if (name == "tail") return tail;
+        if (name == "wc") return wc;
+        if (name == "tee") return tee;
+        return nullptr;
+    }
+
+    const std::vector<std::string>& names() {
+        static const std::vector<std::string> all{"cat", "head", "tail", "wc", "tee"};
+        return all;
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef SHELL_STARTER_CPP_FASTIO_H
+#define SHELL_STARTER_CPP_FASTIO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Data moving builtins (cat, head, tail, wc, tee) that run inside the shell, on a thread when they are a pipeline
+// stage. Bytes go from fd to fd with splice / sendfile / copy_file_range whenever the fd types allow it.
+// Nothing here touches shell state or iostreams, errors are written to the err fd.
+namespace fastio {
+    struct Io {
+        int in = 0;
+        int out = 1;
+        int err = 2;
+    };
+
+    // args without the command name, returns the exit status
+    using Builtin = int (*)(const std::vector<std::string>& args, Io io);
+
+    int cat(const std::vector<std::string>& args, Io io);
+    int head(const std::vector<std::string>& args, Io io);
+    int tail(const std::vector<std::string>& args, Io io);
+    int wc(const std::vector<std::string>& args, Io io);
+    int tee(const std::vector<std::string>& args, Io io);
+
+    // nullptr when name is not one of them
+    Builtin find(std::string_view name);
+    const std::vector<std::string>& names();
+    // whether the builtin does everything these args ask for; false (cat -n, tail -f, wc -m, ...): run the program
+    bool supports(std::string_view name, const std::vector<std::string>& args);
+    // whether name with these args reads its stdin at all
+    bool uses_stdin(std::string_view name, const std::vector<std::string>& args);
+
+    // up to limit bytes (or until EOF) from the current offset of in to out, false with errno set on failure
+    bool copy(int in, int out, uint64_t limit = UINT64_MAX);
+
+    size_t count_newlines(const char* data, size_t size);
+    // in_word carries over between calls, starts out false
+    size_t count_words(const char* data, size_t size, bool& in_word);
+
+    // while one exists, SIGINT makes the builtins stop (status 130) instead of being ignored by the shell
+    class InterruptScope {
+    public:
+        InterruptScope();
+        ~InterruptScope();
+        InterruptScope(const InterruptScope&) = delete;
+        InterruptScope& operator=(const InterruptScope&) = delete;
+    };
+    bool interrupted();
+}
+
+
+#endif //SHELL_STARTER_CPP_FASTIO_H
@@ -0,0 +1,54 @@
+#include "FdStream.hpp"
+
+#include <cerrno>
+#include <unistd.h>
+
+// Output stream buffer on a file descriptor
+
+FdStreambuf::FdStreambuf(int fd) : fd(fd) {
+    setp(buf, buf + sizeof(buf));
+}
+
+FdStreambuf::~FdStreambuf() {
+    flush_buffer();
+}
+
+bool FdStreambuf::write_out(const char* data, size_t size) {
+    if (fd < 0) return true;
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool FdStreambuf::flush_buffer() {
+    bool ok = write_out(pbase(), pptr() - pbase());
+    setp(buf, buf + sizeof(buf));
+    return ok;
+}
+
+FdStreambuf::int_type FdStreambuf::overflow(int_type ch) {
+    if (!flush_buffer()) return traits_type::eof();
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize FdStreambuf::xsputn(const char* s, std::streamsize n) {
+    // large writes skip the buffer
+    if (n >= static_cast<std::streamsize>(sizeof(buf))) {
+        if (!flush_buffer() || !write_out(s, n)) return 0;
+        return n;
+    }
+    return std::streambuf::xsputn(s, n);
+}
+
+int FdStreambuf::sync() {
+    return flush_buffer() ? 0 : -1;
+}
@@ -0,0 +1,30 @@
+#ifndef SHELL_STARTER_CPP_FDSTREAM_H
+#define SHELL_STARTER_CPP_FDSTREAM_H
+
+#include <streambuf>
+
+// Buffered streambuf on a raw fd. Builtins running in the shell write to std::cout / std::cerr,
+// their redirections swap one of these in instead of dup2'ing the shell's own stdout / stderr.
+class FdStreambuf : public std::streambuf {
+public:
+    // fd -1 (closed) swallows the output
+    explicit FdStreambuf(int fd);
+    ~FdStreambuf() override;
+    FdStreambuf(const FdStreambuf&) = delete;
+    FdStreambuf& operator=(const FdStreambuf&) = delete;
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+    int sync() override;
+
+private:
+    int fd;
+    char buf[8192];
+
+    bool write_out(const char* data, size_t size);
+    bool flush_buffer();
+};
+
+
+#endif //SHELL_STARTER_CPP_FDSTREAM_H
@@ -0,0 +1,137 @@
+#include "Frecency.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// Usage scores for ranking completions, saved as "score<TAB>time<TAB>key" lines
+
+const std::string& Frecency::key(std::string_view command, std::string_view argument) const {
+    key_buffer.assign(command);
+    if (!argument.empty()) {
+        key_buffer += '\t';
+        key_buffer += argument;
+    }
+    return key_buffer;
+}
+
+double Frecency::decayed(const Entry& entry, int64_t now) {
+    if (now <= entry.last) return entry.score;
+    return entry.score * std::exp2(-(now - entry.last) / HALF_LIFE);
+}
+
+void Frecency::use(std::string_view command, std::string_view argument) {
+    // a key is one line of the file
+    if (command.empty() || command.find_first_of("\t\n") != std::string_view::npos ||
+        argument.find_first_of("\t\n") != std::string_view::npos) {
+        return;
+    }
+
+    int64_t now = time(nullptr);
+    Entry& entry = entries[key(command, argument)];
+    entry.score = decayed(entry, now) + 1;
+    entry.last = now;
+}
+
+double Frecency::score(std::string_view command, std::string_view argument) const {
+    if (entries.empty()) return 0;
+    auto it = entries.find(key(command, argument));
+    return it == entries.end() ? 0 : decayed(it->second, time(nullptr));
+}
+
+bool Frecency::read_file(const std::filesystem::path& path, std::unordered_map<std::string, Entry>& into) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    std::string text;
+    struct stat st{};
+    if (fstat(fd, &st) == 0) text.resize(st.st_size);
+    size_t got = 0;
+    while (got < text.size()) {
+        ssize_t n = read(fd, text.data() + got, text.size() - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        got += n;
+    }
+    close(fd);
+    text.resize(got);
+
+    for (size_t at = 0; at < text.size();) {
+        size_t nl = text.find('\n', at);
+        if (nl == std::string::npos) break; // cut short, not a whole entry
+        std::string_view line(text.data() + at, nl - at);
+        at = nl + 1;
+
+        size_t tab1 = line.find('\t');
+        size_t tab2 = tab1 == std::string_view::npos ? tab1 : line.find('\t', tab1 + 1);
+        if (tab2 == std::string_view::npos) continue;
+        Entry entry;
+        entry.score = std::strtod(std::string(line.substr(0, tab1)).c_str(), nullptr);
+        entry.last = std::strtoll(std::string(line.substr(tab1 + 1, tab2 - tab1 - 1)).c_str(), nullptr, 10);
+        if (!(entry.score > 0)) continue;
+
+        std::string name(line.substr(tab2 + 1));
+        auto [it, added] = into.try_emplace(std::move(name), entry);
+        if (!added && decayed(entry, entry.last) > decayed(it->second, entry.last)) it->second = entry;
+    }
+    return true;
+}
+
+bool Frecency::load(const std::filesystem::path& path) {
+    entries.clear();
+    return read_file(path, entries);
+}
+
+bool Frecency::save(const std::filesystem::path& path) {
+    int64_t now = time(nullptr);
+
+    // another session may have saved since this one loaded: both started from that file, keep the better score
+    std::unordered_map<std::string, Entry> saved;
+    read_file(path, saved);
+    for (auto& [name, entry] : saved) {
+        auto [it, added] = entries.try_emplace(name, entry);
+        if (!added && decayed(entry, now) > decayed(it->second, now)) it->second = entry;
+    }
+
+    std::vector<std::pair<double, const std::pair<const std::string, Entry>*>> ranked;
+    ranked.reserve(entries.size());
+    for (const auto& e : entries) ranked.emplace_back(decayed(e.second, now), &e);
+    if (ranked.size() > MAX_ENTRIES) {
+        std::nth_element(ranked.begin(), ranked.begin() + MAX_ENTRIES, ranked.end(),
+                         [](const auto& a, const auto& b) { return a.first > b.first; });
+        ranked.resize(MAX_ENTRIES);
+    }
+
+    std::string out;
+    char number[64];
+    for (const auto& [score, e] : ranked) {
+        std::snprintf(number, sizeof(number), "%.6g\t%lld\t", score, static_cast<long long>(now));
+        out += number;
+        out += e->first;
+        out += '\n';
+    }
+
+    std::string tmp = path.string() + ".tmp." + std::to_string(getpid());
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) return false;
+    bool ok = true;
+    for (size_t done = 0; ok && done < out.size();) {
+        ssize_t n = write(fd, out.data() + done, out.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) ok = false;
+        else done += n;
+    }
+    close(fd);
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
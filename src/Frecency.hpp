@@ -0,0 +1,45 @@
+#ifndef SHELL_STARTER_CPP_FRECENCY_H
+#define SHELL_STARTER_CPP_FRECENCY_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// How often and how recently command names, and the arguments given to each command, were used.
+// Every use adds 1 to a score that halves every HALF_LIFE seconds, so a name used daily outranks one used often
+// last year. One hash lookup per use or query.
+class Frecency {
+public:
+    // a use of command, or of argument with command
+    void use(std::string_view command, std::string_view argument = {});
+    // 0 for names never used
+    double score(std::string_view command, std::string_view argument = {}) const;
+    size_t size() const { return entries.size(); }
+
+    // replaces everything with the scores saved in path
+    bool load(const std::filesystem::path& path);
+    // merges in what other sessions saved meanwhile (the higher score wins), keeps the MAX_ENTRIES best and
+    // writes them to path (temp file + rename)
+    bool save(const std::filesystem::path& path);
+
+private:
+    struct Entry {
+        double score = 0;
+        int64_t last = 0; // when score was last brought up to date
+    };
+
+    static constexpr double HALF_LIFE = 7 * 24 * 3600.0;
+    static constexpr size_t MAX_ENTRIES = 10000;
+
+    std::unordered_map<std::string, Entry> entries; // "command" or "command\targument"
+    mutable std::string key_buffer;
+
+    const std::string& key(std::string_view command, std::string_view argument) const;
+    static double decayed(const Entry& entry, int64_t now);
+    static bool read_file(const std::filesystem::path& path, std::unordered_map<std::string, Entry>& into);
+};
+
+
+#endif //SHELL_STARTER_CPP_FRECENCY_H
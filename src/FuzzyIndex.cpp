@@ -0,0 +1,138 @@
+#include "FuzzyIndex.hpp"
+
+#include <algorithm>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Fuzzy command matching: mask prefilter over a flat array, then a scored subsequence match
+
+namespace {
+    unsigned char lower(char c) {
+        return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : static_cast<unsigned char>(c);
+    }
+
+    bool separator(char c) {
+        return c == '-' || c == '_' || c == '.' || c == ' ' || c == '+';
+    }
+
+#if defined(__x86_64__)
+    __attribute__((target("avx2"))) size_t candidates_avx2(const uint64_t* masks, size_t count, uint64_t want,
+                                                           std::vector<uint32_t>& out) {
+        const __m256i w = _mm256_set1_epi64x(static_cast<long long>(want));
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(masks + i));
+            __m256i hit = _mm256_cmpeq_epi64(_mm256_and_si256(m, w), w);
+            unsigned bits = _mm256_movemask_pd(_mm256_castsi256_pd(hit));
+            while (bits) {
+                out.push_back(static_cast<uint32_t>(i + __builtin_ctz(bits)));
+                bits &= bits - 1;
+            }
+        }
+        return i;
+    }
+
+    bool has_avx2() {
+        static const bool avx2 = __builtin_cpu_supports("avx2");
+        return avx2;
+    }
+#endif
+}
+
+void FuzzyIndex::clear() {
+    names.clear();
+    offsets.assign(1, 0);
+    masks.clear();
+}
+
+void FuzzyIndex::add(std::string_view name) {
+    names += name;
+    offsets.push_back(static_cast<uint32_t>(names.size()));
+    masks.push_back(mask_of(name));
+}
+
+uint64_t FuzzyIndex::mask_of(std::string_view text) {
+    uint64_t mask = 0;
+    for (char c : text) mask |= uint64_t{1} << (lower(c) & 63);
+    return mask;
+}
+
+void FuzzyIndex::candidates(uint64_t want, std::vector<uint32_t>& out) const {
+    size_t i = 0;
+#if defined(__x86_64__)
+    if (has_avx2()) i = candidates_avx2(masks.data(), masks.size(), want, out);
+#endif
+    for (; i < masks.size(); ++i) {
+        if ((masks[i] & want) == want) out.push_back(static_cast<uint32_t>(i));
+    }
+}
+
+int FuzzyIndex::score(std::string_view name, std::string_view pattern) {
+    // earliest position where the whole pattern has been seen
+    size_t p = 0;
+    size_t end = 0;
+    for (size_t i = 0; i < name.size(); ++i) {
+        if (lower(name[i]) == static_cast<unsigned char>(pattern[p]) && ++p == pattern.size()) {
+            end = i;
+            break;
+        }
+    }
+    if (p < pattern.size()) return -1;
+
+    // back from there: the latest start, so the window is as short as it gets
+    size_t start = end;
+    p = pattern.size();
+    for (size_t i = end + 1; i-- > 0;) {
+        if (lower(name[i]) == static_cast<unsigned char>(pattern[p - 1]) && --p == 0) {
+            start = i;
+            break;
+        }
+    }
+
+    // every matched byte counts, more at the start of the name or of a word and right after the previous one
+    int total = 0;
+    size_t previous = SIZE_MAX;
+    p = 0;
+    for (size_t i = start; i <= end && p < pattern.size(); ++i) {
+        if (lower(name[i]) != static_cast<unsigned char>(pattern[p])) continue;
+        int s = 16;
+        if (i == 0) s += 32;
+        else if (separator(name[i - 1])) s += 24;
+        if (previous != SIZE_MAX && previous + 1 == i) s += 16;
+        total += s;
+        previous = i;
+        p++;
+    }
+    total -= 2 * static_cast<int>(end - start + 1 - pattern.size()); // bytes skipped inside the window
+    return std::max(total, 0);
+}
+
+std::vector<FuzzyIndex::Hit> FuzzyIndex::best(std::string_view pattern, size_t limit) const {
+    std::string folded(pattern);
+    for (char& c : folded) c = static_cast<char>(lower(c));
+
+    std::vector<uint32_t> found;
+    candidates(mask_of(folded), found);
+
+    std::vector<Hit> hits;
+    for (uint32_t i : found) {
+        std::string_view name(names.data() + offsets[i], offsets[i + 1] - offsets[i]);
+        int s = score(name, folded);
+        if (s >= 0) hits.push_back({name, s});
+    }
+
+    auto better = [](const Hit& a, const Hit& b) {
+        if (a.score != b.score) return a.score > b.score;
+        if (a.name.size() != b.name.size()) return a.name.size() < b.name.size();
+        return a.name < b.name;
+    };
+    if (hits.size() > limit) {
+        std::partial_sort(hits.begin(), hits.begin() + limit, hits.end(), better);
+        hits.resize(limit);
+    } else {
+        std::sort(hits.begin(), hits.end(), better);
+    }
+    return hits;
+}
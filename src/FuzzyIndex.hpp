@@ -0,0 +1,44 @@
+#ifndef SHELL_STARTER_CPP_FUZZYINDEX_H
+#define SHELL_STARTER_CPP_FUZZYINDEX_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Subsequence ("fuzzy") matching over every command name, for set -o fuzzy: "kctl" finds kubectl.
+// Names sit back to back in one buffer. Each has a 64-bit set of the bytes it contains (folded to 6 bits), so most
+// names are rejected by a single AND over a contiguous array (4 at a time with AVX2) before a byte is looked at.
+class FuzzyIndex {
+public:
+    struct Hit {
+        std::string_view name;
+        int score;
+    };
+
+    FuzzyIndex() { clear(); }
+
+    void clear();
+    void add(std::string_view name);
+    size_t size() const { return offsets.size() - 1; }
+
+    // the limit best matches of pattern (case-insensitive), best first, ties go to the shorter name
+    std::vector<Hit> best(std::string_view pattern, size_t limit) const;
+
+    // what the index was built from, the owner decides when it is stale
+    uint64_t source = 0;
+
+private:
+    std::string names;             // every name, back to back
+    std::vector<uint32_t> offsets; // start of each name in names, then names.size()
+    std::vector<uint64_t> masks;   // bytes present in each name
+
+    static uint64_t mask_of(std::string_view text);
+    // appends the index of every name whose mask holds all of want
+    void candidates(uint64_t want, std::vector<uint32_t>& out) const;
+    // < 0 when pattern isn't a subsequence of name
+    static int score(std::string_view name, std::string_view pattern);
+};
+
+
+#endif //SHELL_STARTER_CPP_FUZZYINDEX_H
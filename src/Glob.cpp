@@ -0,0 +1,369 @@
+#include "Glob.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <deque>
+#include <dirent.h>
+#include <fcntl.h>
+#include <mutex>
+#include <optional>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Pattern compiler and directory walker behind pathname expansion
+
+namespace {
+    struct CharClass {
+        std::string_view name;
+        int (*test)(int);
+    };
+
+    constexpr CharClass CLASSES[] = {
+        {"alnum", isalnum}, {"alpha", isalpha}, {"blank", isblank}, {"cntrl", iscntrl},
+        {"digit", isdigit}, {"graph", isgraph}, {"lower", islower}, {"print", isprint},
+        {"punct", ispunct}, {"space", isspace}, {"upper", isupper}, {"xdigit", isxdigit},
+    };
+
+    // [...] starting at open, into set; returns the index of the closing ']' or npos when there is none
+    size_t parse_set(std::string_view text, size_t open, std::bitset<256>& set) {
+        size_t i = open + 1;
+        bool negate = i < text.size() && (text[i] == '!' || text[i] == '^');
+        if (negate) i++;
+
+        bool first = true; // a ']' right after the opening is a member
+        while (i < text.size()) {
+            unsigned char c = text[i];
+            if (c == ']' && !first) {
+                if (negate) set.flip();
+                return i;
+            }
+            first = false;
+
+            if (c == '[' && i + 1 < text.size() && text[i + 1] == ':') {
+                size_t close = text.find(":]", i + 2);
+                if (close != std::string_view::npos) {
+                    std::string_view name = text.substr(i + 2, close - i - 2);
+                    for (const auto& cls : CLASSES) {
+                        if (cls.name != name) continue;
+                        for (int ch = 0; ch < 256; ++ch) {
+                            if (cls.test(ch)) set.set(ch);
+                        }
+                    }
+                    i = close + 2;
+                    continue;
+                }
+            }
+
+            if (c == '\\' && i + 1 < text.size()) c = text[++i];
+            i++;
+            if (i + 1 < text.size() && text[i] == '-' && text[i + 1] != ']') {
+                size_t at = i + 1;
+                if (text[at] == '\\' && at + 1 < text.size()) at++;
+                unsigned char hi = text[at];
+                for (unsigned ch = c; ch <= hi; ++ch) set.set(ch);
+                i = at + 1;
+            } else {
+                set.set(c);
+            }
+        }
+        return std::string_view::npos;
+    }
+}
+
+struct Glob::Walk {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::string> queue;
+    size_t active = 0;  // directories being read right now
+    size_t helpers = 0; // pool tasks submitted and not finished
+    std::vector<std::string> dirs;
+    std::vector<std::string> matches;
+    std::optional<Matcher> leaf; // a copy: a late helper may outlive the pattern cache entry
+    bool dirs_only = false;
+};
+
+Glob::Glob(ThreadPool* pool) : pool(pool), owner(getpid()) {}
+
+Glob::Matcher::Matcher(std::string_view component) {
+    for (size_t i = 0; i < component.size(); ++i) {
+        char c = component[i];
+        if (c == '*') {
+            literal_only = false;
+            if (ops.empty() || ops.back().kind != Op::Star) ops.push_back({Op::Star});
+            continue;
+        }
+        if (c == '?') {
+            literal_only = false;
+            ops.push_back({Op::One});
+            continue;
+        }
+        if (c == '[') {
+            std::bitset<256> set;
+            size_t close = parse_set(component, i, set);
+            if (close != std::string_view::npos) {
+                literal_only = false;
+                ops.push_back({Op::Set, 0, static_cast<uint16_t>(sets.size())});
+                sets.push_back(set);
+                i = close;
+                continue;
+            }
+            // an unclosed [ is an ordinary character
+        }
+        if (c == '\\' && i + 1 < component.size()) c = component[++i];
+        ops.push_back({Op::Char, static_cast<unsigned char>(c)});
+        literal += c;
+    }
+
+    for (const auto& op : ops) {
+        if (op.kind != Op::Star) min_length++;
+    }
+    for (auto op = ops.begin(); op != ops.end() && op->kind == Op::Char; ++op) prefix += static_cast<char>(op->c);
+    for (auto op = ops.rbegin(); op != ops.rend() && op->kind == Op::Char; ++op) suffix += static_cast<char>(op->c);
+    std::reverse(suffix.begin(), suffix.end());
+    dot_ok = prefix.starts_with('.');
+}
+
+bool Glob::Matcher::matches(std::string_view name) const {
+    if (literal_only) return name == literal;
+    if (name == "." || name == "..") return false;
+    if (name.starts_with('.') && !dot_ok) return false;
+    if (name.size() < min_length || !name.starts_with(prefix) || !name.ends_with(suffix)) return false;
+
+    // left to right, going back to the last * on a mismatch: no recursion, O(name * pattern) at worst
+    size_t p = 0, n = 0;
+    size_t star = std::string_view::npos, star_n = 0;
+    while (n < name.size()) {
+        if (p < ops.size()) {
+            const Op& op = ops[p];
+            unsigned char c = name[n];
+            if (op.kind == Op::Star) {
+                star = p++;
+                star_n = n;
+                continue;
+            }
+            if (op.kind == Op::One || (op.kind == Op::Char && op.c == c) || (op.kind == Op::Set && sets[op.set][c])) {
+                p++;
+                n++;
+                continue;
+            }
+        }
+        if (star == std::string_view::npos) return false;
+        p = star + 1;
+        n = ++star_n;
+    }
+    while (p < ops.size() && ops[p].kind == Op::Star) p++;
+    return p == ops.size();
+}
+
+bool Glob::match_name(std::string_view pattern, std::string_view name) {
+    return Matcher(pattern).matches(name);
+}
+
+const Glob::Compiled& Glob::compile(std::string_view pattern) {
+    std::string key(pattern);
+    if (auto it = cache.find(key); it != cache.end()) return it->second;
+
+    Compiled compiled;
+    size_t i = 0;
+    if (pattern.starts_with('/')) {
+        compiled.root = "/";
+        i = pattern.find_first_not_of('/');
+        if (i == std::string_view::npos) i = pattern.size();
+    }
+    compiled.dirs_only = pattern.size() > 1 && pattern.ends_with('/');
+
+    while (i < pattern.size()) {
+        // the component runs to the next unescaped '/'
+        size_t end = i;
+        while (end < pattern.size() && pattern[end] != '/') end += pattern[end] == '\\' ? 2 : 1;
+        end = std::min(end, pattern.size());
+        std::string_view text = pattern.substr(i, end - i);
+        i = end + 1;
+        if (text.empty()) continue; // a//b
+
+        if (text == "**") {
+            if (compiled.components.empty() || compiled.components.back().kind != Component::Recursive) {
+                compiled.components.push_back({Component::Recursive, Matcher("*")});
+            }
+            continue;
+        }
+        Matcher matcher(text);
+        Component::Kind kind = matcher.wild() ? Component::Wild : Component::Literal;
+        compiled.components.push_back({kind, std::move(matcher)});
+    }
+
+    if (cache.size() >= CACHED_PATTERNS) {
+        cache.erase(cache_order.front());
+        cache_order.pop_front();
+    }
+    cache_order.push_back(key);
+    return cache.emplace(std::move(key), std::move(compiled)).first->second;
+}
+
+std::vector<std::string> Glob::expand(std::string_view pattern) {
+    const Compiled& compiled = compile(pattern);
+    std::vector<std::string> out;
+    // no wildcard left ([ without ], all of it escaped): the word stays as it is without a look at the disk
+    bool wild = std::ranges::any_of(compiled.components, [](const Component& c) { return c.kind != Component::Literal; });
+    if (!wild) return out;
+
+    walk(compiled, 0, compiled.root, out);
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+void Glob::walk(const Compiled& pattern, size_t index, const std::string& prefix, std::vector<std::string>& out) {
+    const Component& component = pattern.components[index];
+    bool last = index + 1 == pattern.components.size();
+
+    switch (component.kind) {
+        case Component::Literal: {
+            // nothing to match: no listing, only the final path has to exist
+            std::string path = join(prefix, component.matcher.text());
+            if (!last) {
+                walk(pattern, index + 1, path, out);
+                return;
+            }
+            struct stat st{};
+            if (pattern.dirs_only) {
+                if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) out.push_back(path + "/");
+            } else if (lstat(path.c_str(), &st) == 0) {
+                out.push_back(std::move(path));
+            }
+            return;
+        }
+
+        case Component::Wild: {
+            DirListing listing;
+            if (!read_dir(prefix, listing)) return;
+            for (const auto& entry : listing.entries) {
+                std::string_view name = listing.name(entry);
+                if (!component.matcher.matches(name)) continue;
+                std::string path = join(prefix, name);
+                // only directories go on, d_type says which without a stat
+                if (!last || pattern.dirs_only) {
+                    if (!is_directory(path, entry.type, true)) continue;
+                }
+                if (!last) walk(pattern, index + 1, path, out);
+                else out.push_back(pattern.dirs_only ? path + "/" : path);
+            }
+            return;
+        }
+
+        case Component::Recursive: {
+            // **/leaf and a final ** are matched while walking, anything longer walks the rest from each directory
+            const Matcher* leaf = nullptr;
+            if (last) leaf = &component.matcher;
+            else if (index + 2 == pattern.components.size() && pattern.components[index + 1].kind == Component::Wild) {
+                leaf = &pattern.components[index + 1].matcher;
+            }
+
+            std::vector<std::string> dirs;
+            std::vector<std::string> matches;
+            directories_below(prefix, leaf, pattern.dirs_only, dirs, matches);
+            if (leaf) {
+                // a final ** has the directory it starts from as its first match, written as bash's globstar does:
+                // with a '/' when that directory was named, without when a pattern matched it
+                if (last && !prefix.empty() && !prefix.ends_with('/') && is_directory(prefix, DT_UNKNOWN, true)) {
+                    bool named = pattern.components[index - 1].kind == Component::Literal;
+                    out.push_back(pattern.dirs_only || named ? prefix + "/" : prefix);
+                }
+                out.insert(out.end(), std::make_move_iterator(matches.begin()), std::make_move_iterator(matches.end()));
+                return;
+            }
+            for (const auto& dir : dirs) walk(pattern, index + 1, dir, out);
+            return;
+        }
+    }
+}
+
+void Glob::directories_below(const std::string& prefix, const Matcher* leaf, bool dirs_only,
+                             std::vector<std::string>& dirs, std::vector<std::string>& matches) {
+    auto state = std::make_shared<Walk>();
+    state->queue.push_back(prefix);
+    state->dirs.push_back(prefix);
+    if (leaf) state->leaf = *leaf;
+    state->dirs_only = dirs_only;
+
+    work_on(state, getpid() == owner ? pool : nullptr, false);
+
+    // finished: the queue is empty and nobody is reading, helpers still on their way find nothing to do
+    std::lock_guard lock(state->mutex);
+    dirs = std::move(state->dirs);
+    matches = std::move(state->matches);
+}
+
+void Glob::work_on(const std::shared_ptr<Walk>& walk, ThreadPool* pool, bool helper) {
+    std::unique_lock lock(walk->mutex);
+    while (true) {
+        if (walk->queue.empty()) {
+            // a helper leaves, the caller waits for the directories still being read, they may queue more
+            if (helper || walk->active == 0) break;
+            walk->changed.wait(lock, [&walk]() { return !walk->queue.empty() || walk->active == 0; });
+            continue;
+        }
+
+        std::string dir = std::move(walk->queue.front());
+        walk->queue.pop_front();
+        walk->active++;
+        lock.unlock();
+
+        DirListing listing;
+        std::vector<std::string> subdirs;
+        std::vector<std::string> found;
+        if (read_dir(dir, listing)) {
+            for (const auto& entry : listing.entries) {
+                std::string_view name = listing.name(entry);
+                std::string path = join(dir, name);
+                if (walk->leaf && walk->leaf->matches(name) &&
+                    (!walk->dirs_only || is_directory(path, entry.type, true))) {
+                    found.push_back(walk->dirs_only ? path + "/" : path);
+                }
+                // ** doesn't go into hidden directories and doesn't follow links
+                if (!name.starts_with('.') && is_directory(path, entry.type, false)) subdirs.push_back(std::move(path));
+            }
+        }
+
+        lock.lock();
+        for (auto& sub : subdirs) {
+            walk->dirs.push_back(sub);
+            walk->queue.push_back(std::move(sub));
+        }
+        walk->matches.insert(walk->matches.end(), std::make_move_iterator(found.begin()),
+                             std::make_move_iterator(found.end()));
+        walk->active--;
+        // more directories waiting than threads on them: one more helper, up to the pool's size
+        if (pool && walk->queue.size() > 1 && walk->helpers < pool->size()) {
+            walk->helpers++;
+            pool->submit([walk, pool]() { work_on(walk, pool, true); });
+        }
+        walk->changed.notify_all();
+    }
+    if (helper) walk->helpers--;
+}
+
+bool Glob::read_dir(const std::string& prefix, DirListing& listing) {
+    return listing.read(prefix.empty() ? "." : prefix.c_str());
+}
+
+bool Glob::is_directory(const std::string& path, unsigned char type, bool follow) {
+    if (type == DT_DIR) return true;
+    if (type != DT_LNK && type != DT_UNKNOWN) return false;
+    // links, and file systems without d_type
+    struct stat st{};
+    int rc = follow ? stat(path.c_str(), &st) : lstat(path.c_str(), &st);
+    return rc == 0 && S_ISDIR(st.st_mode);
+}
+
+std::string Glob::join(const std::string& prefix, std::string_view name) {
+    if (prefix.empty()) return std::string(name);
+    std::string path;
+    path.reserve(prefix.size() + 1 + name.size());
+    path += prefix;
+    if (!prefix.ends_with('/')) path += '/';
+    path += name;
+    return path;
+}
@@ -0,0 +1,99 @@
+#ifndef SHELL_STARTER_CPP_GLOB_H
+#define SHELL_STARTER_CPP_GLOB_H
+
+#include <bitset>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+
+#include "DirListing.hpp"
+
+class ThreadPool;
+
+// Pathname expansion: * ? [...] within a path component, ** as a whole component for any number of directories.
+// A pattern is split at '/' and compiled once (the last few stay cached). Only directories a component can still
+// match are read, with getdents64 and d_type, so matching names costs no stat(). The directories under a ** are
+// read on the thread pool, the calling thread working along.
+// Like POSIX glob: results sorted byte by byte, a leading '.' is only matched by a '.' in the pattern, "." and ".."
+// never; ** doesn't descend into hidden directories or symlinks.
+class Glob {
+public:
+    // without a pool ** is walked on the calling thread
+    explicit Glob(ThreadPool* pool = nullptr);
+
+    // paths matching pattern, sorted; empty when nothing does or nothing in it is a wildcard.
+    // A backslash makes the next character literal.
+    std::vector<std::string> expand(std::string_view pattern);
+
+    // one name against one component pattern, for shell_bench
+    static bool match_name(std::string_view pattern, std::string_view name);
+
+private:
+    // one path component without '/'
+    class Matcher {
+    public:
+        explicit Matcher(std::string_view component);
+        bool matches(std::string_view name) const;
+        bool wild() const { return !literal_only; }
+        // the component with its escapes removed, for literal components
+        const std::string& text() const { return literal; }
+
+    private:
+        struct Op {
+            enum Kind : uint8_t { Char, One, Star, Set };
+            Kind kind;
+            unsigned char c = 0; // Char
+            uint16_t set = 0;    // Set: index into sets
+        };
+
+        std::vector<Op> ops;
+        std::vector<std::bitset<256>> sets;
+        std::string literal;
+        std::string prefix; // every match starts with prefix and ends with suffix, checked before anything else
+        std::string suffix;
+        size_t min_length = 0;
+        bool literal_only = true;
+        bool dot_ok = false; // starts with a literal '.', hidden names may match
+    };
+
+    struct Component {
+        enum Kind { Literal, Wild, Recursive };
+        Kind kind;
+        Matcher matcher;
+    };
+
+    struct Compiled {
+        std::string root; // "/" for absolute patterns, "" otherwise
+        std::vector<Component> components;
+        bool dirs_only = false; // trailing '/'
+    };
+
+    // state of one ** walk, shared with the pool tasks helping it
+    struct Walk;
+
+    static constexpr size_t CACHED_PATTERNS = 32;
+
+    ThreadPool* pool;
+    pid_t owner; // a forked subshell walks alone, the pool's workers live in the parent
+    std::unordered_map<std::string, Compiled> cache;
+    std::list<std::string> cache_order; // oldest first
+
+    const Compiled& compile(std::string_view pattern);
+    void walk(const Compiled& pattern, size_t index, const std::string& prefix, std::vector<std::string>& out);
+    // every directory below prefix (prefix included) that ** may enter, read in parallel. With a leaf, the entries of
+    // each directory matching it are collected on the way, so a pattern ending in **/leaf reads each directory once.
+    void directories_below(const std::string& prefix, const Matcher* leaf, bool dirs_only,
+                           std::vector<std::string>& dirs, std::vector<std::string>& matches);
+    static void work_on(const std::shared_ptr<Walk>& walk, ThreadPool* pool, bool helper);
+    static bool read_dir(const std::string& prefix, DirListing& listing);
+    static bool is_directory(const std::string& path, unsigned char type, bool follow);
+    static std::string join(const std::string& prefix, std::string_view name);
+};
+
+
+#endif //SHELL_STARTER_CPP_GLOB_H
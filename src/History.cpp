@@ -0,0 +1,385 @@
+#include "History.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_set>
+
+// History storage, the history file is never read line by line into strings
+
+namespace {
+    constexpr uint64_t MIN_COMPACT_SIZE = 256 << 10; // smaller files are never worth rewriting
+
+    // flock() on the lock file for as long as it lives, nothing when there is no lock file
+    class FileLock {
+    public:
+        FileLock(int fd, int operation) : fd(fd) {
+            if (fd >= 0) flock(fd, operation);
+        }
+        ~FileLock() {
+            if (fd >= 0) flock(fd, LOCK_UN);
+        }
+        FileLock(const FileLock&) = delete;
+        FileLock& operator=(const FileLock&) = delete;
+
+    private:
+        int fd;
+    };
+}
+
+History::~History() {
+    unmap();
+    if (lock_fd >= 0) close(lock_fd);
+}
+
+void History::unmap() {
+    if (map) {
+        munmap(const_cast<char*>(map), map_size);
+        map = nullptr;
+        map_size = 0;
+    }
+    file_lines.clear();
+    indexed = false;
+}
+
+void History::clear() {
+    unmap();
+    indexed = true; // nothing to index
+    arena.clear();
+    arena_lines.assign(1, 0);
+    front = 0;
+    session_synced = 0;
+    gen++;
+}
+
+bool History::load(const std::filesystem::path& path) {
+    clear();
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st{};
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            map = static_cast<const char*>(addr);
+            map_size = st.st_size;
+            indexed = false; // lines are found on first access
+        }
+    }
+    close(fd);
+    return true;
+}
+
+void History::build_index() {
+    indexed = true;
+    file_lines.clear();
+    if (!map) return;
+
+    const char* p = map;
+    const char* end = map + map_size;
+    while (p < end) {
+        file_lines.push_back(p - map);
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        p = nl ? nl + 1 : end;
+    }
+    file_lines.push_back(map_size);
+}
+
+size_t History::file_count() {
+    if (!indexed) build_index();
+    return file_lines.empty() ? 0 : file_lines.size() - 1;
+}
+
+std::string_view History::arena_entry(size_t i) const {
+    return std::string_view(arena).substr(arena_lines[i], arena_lines[i + 1] - arena_lines[i]);
+}
+
+void History::prepend(std::string_view line) {
+    // only right after load(), before the session added anything
+    push_back(line);
+    front++;
+    gen++;
+}
+
+void History::push_back(std::string_view line) {
+    arena.append(line);
+    arena_lines.push_back(arena.size());
+}
+
+size_t History::size() {
+    return arena_lines.size() - 1 + file_count();
+}
+
+std::string_view History::operator[](size_t i) {
+    if (i < front) return arena_entry(i);
+    i -= front;
+
+    size_t files = file_count();
+    if (i < files) {
+        // without the newline
+        size_t start = file_lines[i];
+        size_t end = file_lines[i + 1];
+        if (end > start && map[end - 1] == '\n') end--;
+        return {map + start, end - start};
+    }
+    return arena_entry(front + i - files);
+}
+
+bool History::write_all(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t n = write(fd, data.data(), data.size());
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data.remove_prefix(n);
+    }
+    return true;
+}
+
+bool History::write_to(const std::filesystem::path& path) {
+    std::string tmp = path.string() + ".tmp." + std::to_string(getpid());
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) return false;
+
+    // flushed in large blocks, not per line
+    std::string buf;
+    bool ok = true;
+    size_t total = size();
+    for (size_t i = 0; i < total && ok; ++i) {
+        buf += (*this)[i];
+        buf += '\n';
+        if (buf.size() >= (1 << 20)) {
+            ok = write_all(fd, buf);
+            buf.clear();
+        }
+    }
+    ok = ok && write_all(fd, buf);
+    close(fd);
+
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool History::append_to(const std::filesystem::path& path, size_t from) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0) return false;
+
+    std::string buf;
+    for (size_t i = from; i < size(); ++i) {
+        buf += (*this)[i];
+        buf += '\n';
+    }
+    bool ok = write_all(fd, buf);
+    close(fd);
+    return ok;
+}
+
+std::string History::lock_path(const std::filesystem::path& path) {
+    return path.string() + ".lock";
+}
+
+bool History::open_histfile(const std::filesystem::path& path) {
+    histfile_path = path;
+    if (lock_fd >= 0) close(lock_fd);
+    // without a lock file (read-only directory) writes just aren't serialized
+    lock_fd = open(lock_path(path).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+
+    bool ok = load(path);
+    struct stat st{};
+    if (stat(path.c_str(), &st) == 0) {
+        known_dev = st.st_dev;
+        known_ino = st.st_ino;
+    } else if (errno == ENOENT) {
+        ok = true; // created by the first record()
+    }
+    known_size = map_size;
+    compact_at = std::max(2 * known_size, MIN_COMPACT_SIZE);
+    return ok;
+}
+
+std::vector<std::string> History::take_unsynced() {
+    size_t count = session_count() - session_synced;
+    size_t first = arena_lines.size() - 1 - count;
+    std::vector<std::string> taken;
+    taken.reserve(count);
+    for (size_t i = first; i + 1 < arena_lines.size(); ++i) taken.emplace_back(arena_entry(i));
+    arena.resize(arena_lines[first]);
+    arena_lines.resize(first + 1);
+    if (count > 0) gen++;
+    return taken;
+}
+
+void History::catch_up(int fd) {
+    struct stat st{};
+    if (fstat(fd, &st) != 0) return;
+
+    bool replaced = st.st_dev != known_dev || st.st_ino != known_ino || static_cast<uint64_t>(st.st_size) < known_size;
+    if (!replaced && static_cast<uint64_t>(st.st_size) == known_size) return;
+
+    // entries record() couldn't write aren't in the file, they go back after whatever is read from it
+    std::vector<std::string> unsynced = take_unsynced();
+
+    if (replaced) {
+        // compacted or rewritten: it holds this session's written entries too, start over from it
+        load(histfile_path);
+        known_dev = st.st_dev;
+        known_ino = st.st_ino;
+        known_size = map_size;
+        compact_at = std::max(2 * known_size, MIN_COMPACT_SIZE);
+    } else {
+        // only what was appended since the last look
+        std::string added(st.st_size - known_size, '\0');
+        size_t got = 0;
+        while (got < added.size()) {
+            ssize_t n = pread(fd, added.data() + got, added.size() - got, known_size + got);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            got += n;
+        }
+        // a writer that doesn't take the lock may be halfway through a line
+        size_t end = std::string_view(added.data(), got).rfind('\n');
+        if (end != std::string_view::npos) {
+            for (size_t at = 0; at <= end;) {
+                size_t nl = added.find('\n', at);
+                push_back(std::string_view(added).substr(at, nl - at));
+                at = nl + 1;
+            }
+            known_size += end + 1;
+        }
+    }
+
+    for (const auto& entry : unsynced) push_back(entry);
+    session_synced = session_count() - unsynced.size();
+}
+
+void History::refresh() {
+    if (histfile_path.empty()) return;
+
+    // the usual case, nobody wrote anything: one stat, no lock
+    struct stat st{};
+    if (stat(histfile_path.c_str(), &st) != 0) return;
+    if (st.st_dev == known_dev && st.st_ino == known_ino && static_cast<uint64_t>(st.st_size) == known_size) return;
+
+    FileLock lock(lock_fd, LOCK_SH);
+    // opened under the lock, so it is the file compact() left in place
+    int fd = open(histfile_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    catch_up(fd);
+    close(fd);
+}
+
+bool History::record(std::string_view line) {
+    if (histfile_path.empty()) {
+        push_back(line);
+        return true;
+    }
+
+    FileLock lock(lock_fd, LOCK_EX);
+    int fd = open(histfile_path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        push_back(line);
+        return false;
+    }
+
+    // other sessions' lines first, they were entered before this one
+    catch_up(fd);
+    push_back(line);
+
+    // along with the entries earlier calls couldn't write
+    std::string text;
+    for (size_t i = size() - (session_count() - session_synced); i < size(); ++i) {
+        text += (*this)[i];
+        text += '\n';
+    }
+    bool ok = write_all(fd, text);
+    close(fd);
+    if (ok) {
+        known_size += text.size();
+        session_synced = session_count();
+    }
+    return ok;
+}
+
+void History::mark_synced() {
+    session_synced = session_count();
+}
+
+bool History::sync_histfile() {
+    if (histfile_path.empty()) return false;
+
+    size_t unsynced = session_count() - session_synced;
+    if (unsynced == 0) return true;
+
+    FileLock lock(lock_fd, LOCK_EX);
+    bool ok = append_to(histfile_path, size() - unsynced);
+    if (ok) mark_synced();
+    return ok;
+}
+
+bool History::compact(const std::filesystem::path& path, size_t keep) {
+    int lock_fd = open(lock_path(path).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    bool ok = false;
+    {
+        FileLock lock(lock_fd, LOCK_EX);
+
+        std::string text;
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st{};
+        if (fd >= 0 && fstat(fd, &st) == 0) {
+            text.resize(st.st_size);
+            size_t got = 0;
+            while (got < text.size()) {
+                ssize_t n = read(fd, text.data() + got, text.size() - got);
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) break;
+                got += n;
+            }
+            text.resize(got);
+        }
+        if (fd >= 0) close(fd);
+
+        std::vector<std::string_view> lines;
+        for (size_t at = 0; at < text.size();) {
+            size_t nl = text.find('\n', at);
+            if (nl == std::string::npos) nl = text.size();
+            lines.emplace_back(text.data() + at, nl - at);
+            at = nl + 1;
+        }
+
+        // newest first: the last copy of a line is the one that stays
+        std::unordered_set<std::string_view> seen;
+        std::vector<std::string_view> kept;
+        for (size_t i = lines.size(); i-- > 0 && kept.size() < keep;) {
+            if (seen.insert(lines[i]).second) kept.push_back(lines[i]);
+        }
+
+        ok = kept.size() == lines.size(); // nothing to drop
+        if (!ok) {
+            std::string out;
+            out.reserve(text.size());
+            for (size_t i = kept.size(); i-- > 0;) {
+                out += kept[i];
+                out += '\n';
+            }
+
+            std::string tmp = path.string() + ".tmp." + std::to_string(getpid());
+            int out_fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+            ok = out_fd >= 0 && write_all(out_fd, out);
+            if (out_fd >= 0) close(out_fd);
+            if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+                unlink(tmp.c_str());
+                ok = false;
+            }
+        }
+    }
+    if (lock_fd >= 0) close(lock_fd);
+    return ok;
+}
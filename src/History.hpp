@@ -0,0 +1,101 @@
+#ifndef SHELL_STARTER_CPP_HISTORY_H
+#define SHELL_STARTER_CPP_HISTORY_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Command history backed by an mmap'd history file.
+// File lines are served straight from the mapping through a line-offset index that is only built on first use,
+// commands entered in this session live in one arena string.
+//
+// Order of the entries: prepended arena entries, the file's lines, then the session's arena entries.
+//
+// HISTFILE is shared by every shell that uses it: each entry is appended the moment it is recorded and lines
+// appended by other sessions are read from the last known offset. Writers hold flock() on "<HISTFILE>.lock", which
+// survives compact() swapping in a deduplicated file with rename.
+class History {
+public:
+    History() = default;
+    ~History();
+    History(const History&) = delete;
+    History& operator=(const History&) = delete;
+
+    // replaces everything with the lines of path, false when it can't be opened
+    bool load(const std::filesystem::path& path);
+    // entry placed before the file's lines
+    void prepend(std::string_view line);
+    void push_back(std::string_view line);
+    void clear();
+
+    size_t size();
+    bool empty() { return size() == 0; }
+    // valid until the next push_back / load
+    std::string_view operator[](size_t i);
+    std::string_view back() { return (*this)[size() - 1]; }
+
+    // whole history into path (temp file + rename, a mapping of the old file stays valid)
+    bool write_to(const std::filesystem::path& path);
+    // entries [from, size()) appended to path with a single write
+    bool append_to(const std::filesystem::path& path, size_t from);
+
+    // HISTFILE: mapped at startup, entries are written as they are recorded
+    bool open_histfile(const std::filesystem::path& path);
+    // push_back + append to HISTFILE (after picking up what other sessions wrote), with any session entry an earlier
+    // call couldn't write; false when it can't be written
+    bool record(std::string_view line);
+    // lines other sessions appended since the last look, all of HISTFILE again once it was compacted
+    void refresh();
+    // appends the session entries record() failed to write
+    bool sync_histfile();
+    // the history file already holds everything in memory (history -w / -a on HISTFILE)
+    void mark_synced();
+    const std::filesystem::path& histfile() const { return histfile_path; }
+
+    // HISTFILE grew to twice its size since it was opened or last compacted
+    bool needs_compaction() const { return !histfile_path.empty() && known_size > compact_at; }
+    void compaction_started() { compact_at = 2 * known_size; }
+    // keeps the newest keep distinct lines of path (the last copy of each), swapped in with rename under the lock.
+    // Touches nothing but the file, so it can run on any thread.
+    static bool compact(const std::filesystem::path& path, size_t keep);
+
+    // changes whenever existing entries move or disappear (load, clear, prepend), push_back keeps it
+    uint64_t generation() const { return gen; }
+
+private:
+    const char* map = nullptr;
+    size_t map_size = 0;
+    bool indexed = false;
+    std::vector<uint64_t> file_lines; // start offset of every line of the mapping + end sentinel
+
+    std::string arena;
+    std::vector<uint64_t> arena_lines{0}; // start offset of every arena entry + end sentinel
+    size_t front = 0;                     // arena entries that come before the file's lines
+
+    std::filesystem::path histfile_path;
+    int lock_fd = -1;          // <HISTFILE>.lock
+    uint64_t known_dev = 0;    // HISTFILE as last read: other sessions' lines start at known_size
+    uint64_t known_ino = 0;
+    uint64_t known_size = 0;
+    uint64_t compact_at = 0;
+    size_t session_synced = 0; // session entries already in HISTFILE
+    uint64_t gen = 0;
+
+    void unmap();
+    void build_index();
+    size_t file_count();
+    size_t session_count() const { return arena_lines.size() - 1 - front; }
+    std::string_view arena_entry(size_t i) const;
+    static bool write_all(int fd, std::string_view data);
+    static std::string lock_path(const std::filesystem::path& path);
+    // session entries not in HISTFILE yet, taken off the end of the arena
+    std::vector<std::string> take_unsynced();
+    // with the lock held: what other sessions did to HISTFILE, fd open on it.
+    // Session entries not written yet stay, after the lines read from the file.
+    void catch_up(int fd);
+};
+
+
+#endif //SHELL_STARTER_CPP_HISTORY_H
@@ -0,0 +1,100 @@
+#include "HistoryIndex.hpp"
+
+#include <algorithm>
+
+// n-gram -> block posting lists, kept in step with the history
+
+uint32_t HistoryIndex::bigram(unsigned char a, unsigned char b) {
+    return (uint32_t(a) << 8) | b;
+}
+
+uint32_t HistoryIndex::trigram(unsigned char a, unsigned char b, unsigned char c) {
+    // the top byte keeps trigrams apart from bigrams
+    return (1u << 24) | (uint32_t(a) << 16) | (uint32_t(b) << 8) | c;
+}
+
+void HistoryIndex::add(std::string_view entry, uint32_t block) {
+    auto post = [&](uint32_t key) {
+        auto& list = postings[key];
+        if (list.empty() || list.back() != block) list.push_back(block);
+    };
+
+    for (size_t i = 0; i + 1 < entry.size(); ++i) {
+        post(bigram(entry[i], entry[i + 1]));
+        if (i + 2 < entry.size()) post(trigram(entry[i], entry[i + 1], entry[i + 2]));
+    }
+}
+
+void HistoryIndex::update(History& history) {
+    if (generation != history.generation()) {
+        postings.clear();
+        indexed = 0;
+        generation = history.generation();
+    }
+
+    size_t size = history.size();
+    for (; indexed < size; ++indexed) add(history[indexed], indexed / BLOCK);
+}
+
+std::vector<uint32_t> HistoryIndex::keys(std::string_view query) {
+    std::vector<uint32_t> result;
+    if (query.size() == 2) result.push_back(bigram(query[0], query[1]));
+    for (size_t i = 0; i + 2 < query.size(); ++i) result.push_back(trigram(query[i], query[i + 1], query[i + 2]));
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+size_t HistoryIndex::search(History& history, std::string_view query, size_t before) {
+    update(history);
+    before = std::min(before, history.size());
+    if (before == 0) return npos;
+
+    auto matches = [&](size_t i) { return history[i].find(query) != std::string_view::npos; };
+
+    std::vector<uint32_t> needed = keys(query);
+    if (needed.empty()) {
+        // a single character, no list would be shorter than the history itself
+        for (size_t i = before; i-- > 0;) {
+            if (matches(i)) return i;
+        }
+        return npos;
+    }
+
+    std::vector<const std::vector<uint32_t>*> lists;
+    for (uint32_t key : needed) {
+        auto found = postings.find(key);
+        if (found == postings.end()) return npos;
+        lists.push_back(&found->second);
+    }
+    std::sort(lists.begin(), lists.end(), [](auto* a, auto* b) { return a->size() < b->size(); });
+
+    // walk the shortest list from the newest block down, the others are checked by binary search
+    const auto& lead = *lists[0];
+    uint32_t last_block = (before - 1) / BLOCK;
+    auto it = std::upper_bound(lead.begin(), lead.end(), last_block);
+    while (it != lead.begin()) {
+        uint32_t block = *--it;
+
+        bool candidate = std::all_of(lists.begin() + 1, lists.end(), [block](auto* list) {
+            return std::binary_search(list->begin(), list->end(), block);
+        });
+        if (!candidate) continue;
+
+        size_t first = size_t(block) * BLOCK;
+        for (size_t i = std::min(before, first + BLOCK); i-- > first;) {
+            if (matches(i)) return i;
+        }
+    }
+    return npos;
+}
+
+size_t HistoryIndex::memory_usage() const {
+    // one pointer per bucket, a node (next pointer, key, list) per n-gram
+    size_t total = postings.bucket_count() * sizeof(void*);
+    for (const auto& [key, list] : postings) {
+        total += sizeof(void*) + sizeof(key) + sizeof(list) + list.capacity() * sizeof(uint32_t);
+    }
+    return total;
+}
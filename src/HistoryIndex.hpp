@@ -0,0 +1,42 @@
+#ifndef SHELL_STARTER_CPP_HISTORYINDEX_H
+#define SHELL_STARTER_CPP_HISTORYINDEX_H
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "History.hpp"
+
+// Substring index over the history for reverse incremental search (Ctrl-R).
+// History is cut into blocks of BLOCK entries, every bigram and trigram that occurs keeps the ascending list of
+// blocks it occurs in. A query only looks at the blocks that contain all of its n-grams, newest first,
+// and checks the entries of those blocks with a plain find().
+class HistoryIndex {
+public:
+    static constexpr size_t npos = SIZE_MAX;
+    static constexpr size_t BLOCK = 64;
+
+    // indexes the entries added since the last call, starts over when the history was reloaded
+    void update(History& history);
+
+    // newest entry with index < before that contains query, npos when there is none
+    size_t search(History& history, std::string_view query, size_t before);
+
+    size_t memory_usage() const;
+
+private:
+    // n-gram -> blocks, bigrams and trigrams with distinct keys
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings;
+    size_t indexed = 0;
+    uint64_t generation = UINT64_MAX;
+
+    void add(std::string_view entry, uint32_t block);
+    static uint32_t bigram(unsigned char a, unsigned char b);
+    static uint32_t trigram(unsigned char a, unsigned char b, unsigned char c);
+    // keys a matching entry must contain, empty when the query is too short to use the index
+    static std::vector<uint32_t> keys(std::string_view query);
+};
+
+
+#endif //SHELL_STARTER_CPP_HISTORYINDEX_H
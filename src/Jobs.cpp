@@ -0,0 +1,171 @@
+#include "Jobs.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sys/wait.h>
+
+// Job control bookkeeping, the shell decides who owns the terminal
+
+bool JobTable::Job::done() const {
+    return std::all_of(procs.begin(), procs.end(), [](const Process& p) { return p.done; });
+}
+
+bool JobTable::Job::stopped() const {
+    bool any_stopped = false;
+    for (const auto& p : procs) {
+        if (!p.done && !p.stopped) return false; // still running
+        any_stopped |= p.stopped;
+    }
+    return any_stopped;
+}
+
+int JobTable::Job::exit_status() const {
+    if (procs.empty()) return 0;
+    int status = procs.back().status;
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return 0;
+}
+
+JobTable::Job& JobTable::add(pid_t pgid, const std::vector<pid_t>& pids, std::string command, bool background) {
+    int id = 1;
+    for (const auto& job : jobs) id = std::max(id, job.id + 1);
+
+    Job job{id, pgid, std::move(command), {}};
+    for (pid_t pid : pids) job.procs.push_back({pid});
+    job.background = background;
+    jobs.push_back(std::move(job));
+    return jobs.back();
+}
+
+void JobTable::remove(const Job& job) {
+    jobs.remove_if([&job](const Job& j) { return &j == &job; });
+}
+
+JobTable::Job* JobTable::current() {
+    return jobs.empty() ? nullptr : &jobs.back();
+}
+
+JobTable::Job* JobTable::previous() {
+    if (jobs.size() < 2) return nullptr;
+    return &*std::prev(jobs.end(), 2);
+}
+
+JobTable::Job* JobTable::find(const std::string& spec) {
+    if (spec.empty() || spec == "%" || spec == "%%" || spec == "%+") return current();
+    if (spec == "%-") return previous();
+
+    if (spec[0] == '%') {
+        std::string rest = spec.substr(1);
+        bool numeric = !rest.empty() && std::all_of(rest.begin(), rest.end(), ::isdigit);
+        long id = numeric ? std::strtol(rest.c_str(), nullptr, 10) : 0;
+        for (auto& job : jobs) {
+            if (numeric ? job.id == id : job.command.starts_with(rest)) return &job;
+        }
+        return nullptr;
+    }
+
+    // plain pid
+    if (!std::all_of(spec.begin(), spec.end(), ::isdigit)) return nullptr;
+    long pid = std::strtol(spec.c_str(), nullptr, 10);
+    for (auto& job : jobs) {
+        for (const auto& p : job.procs) {
+            if (p.pid == pid) return &job;
+        }
+    }
+    return nullptr;
+}
+
+void JobTable::record(Process& proc, int status, const struct rusage& usage) {
+    if (WIFSTOPPED(status)) {
+        proc.stopped = true;
+    } else if (WIFCONTINUED(status)) {
+        proc.stopped = false;
+    } else {
+        proc.done = true;
+        proc.stopped = false;
+        proc.status = status;
+        proc.usage = usage;
+    }
+}
+
+void JobTable::wait_for(Job& job) {
+    for (auto& proc : job.procs) {
+        while (!proc.done && !proc.stopped) {
+            int status = 0;
+            struct rusage usage{};
+            pid_t r = wait4(proc.pid, &status, WUNTRACED, &usage);
+            if (r == proc.pid) {
+                record(proc, status, usage);
+            } else if (r < 0 && errno != EINTR) {
+                proc.done = true; // somebody else reaped it
+            }
+        }
+    }
+}
+
+void JobTable::reap() {
+    for (auto& job : jobs) {
+        bool was_done = job.done();
+        bool was_stopped = job.stopped();
+
+        for (auto& proc : job.procs) {
+            if (proc.done) continue;
+            int status = 0;
+            struct rusage usage{};
+            pid_t r = wait4(proc.pid, &status, WNOHANG | WUNTRACED | WCONTINUED, &usage);
+            if (r == proc.pid) {
+                record(proc, status, usage);
+            } else if (r < 0 && errno == ECHILD) {
+                proc.done = true;
+            }
+        }
+
+        if (job.done() != was_done || job.stopped() != was_stopped) job.notified = false;
+    }
+}
+
+std::string JobTable::describe(const Job& job) {
+    char mark = &job == current() ? '+' : &job == previous() ? '-' : ' ';
+
+    std::string state;
+    if (job.done()) {
+        int status = job.procs.back().status;
+        if (WIFSIGNALED(status)) {
+            state = strsignal(WTERMSIG(status));
+        } else if (job.exit_status() != 0) {
+            state = "Exit " + std::to_string(job.exit_status());
+        } else {
+            state = "Done";
+        }
+    } else if (job.stopped()) {
+        state = "Stopped";
+    } else {
+        state = "Running";
+    }
+    state.resize(std::max<size_t>(state.size(), 24), ' ');
+
+    std::string line = "[" + std::to_string(job.id) + "]" + mark + "  " + state + job.command;
+    if (!job.done() && !job.stopped()) line += " &";
+    return line;
+}
+
+std::vector<std::string> JobTable::take_notifications() {
+    std::vector<std::string> lines;
+    for (auto it = jobs.begin(); it != jobs.end();) {
+        if (it->background && it->done()) {
+            lines.push_back(describe(*it));
+            it = jobs.erase(it);
+            continue;
+        }
+        if (it->stopped() && !it->notified) {
+            lines.push_back(describe(*it));
+            it->notified = true;
+        }
+        ++it;
+    }
+    return lines;
+}
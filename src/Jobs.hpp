@@ -0,0 +1,61 @@
+#ifndef SHELL_STARTER_CPP_JOBS_H
+#define SHELL_STARTER_CPP_JOBS_H
+
+#include <list>
+#include <string>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <vector>
+
+// Job table: one job per pipeline, foreground or background
+class JobTable {
+public:
+    struct Process {
+        pid_t pid;
+        int status = 0; // raw waitpid status
+        bool done = false;
+        bool stopped = false;
+        struct rusage usage{}; // from wait4, once done
+    };
+
+    struct Job {
+        int id;
+        pid_t pgid;
+        std::string command;
+        std::vector<Process> procs;
+        bool background = false;
+        bool notified = false; // state change already reported
+
+        bool done() const;
+        bool stopped() const;
+        // exit status of the last stage, 128 + signal when it was killed
+        int exit_status() const;
+    };
+
+    Job& add(pid_t pgid, const std::vector<pid_t>& pids, std::string command, bool background);
+    void remove(const Job& job);
+
+    // %n, %%, %+, %-, %prefix or a pid; nullptr when nothing matches
+    Job* find(const std::string& spec);
+    Job* current();
+    Job* previous();
+    std::list<Job>& all() { return jobs; }
+    bool empty() const { return jobs.empty(); }
+
+    // blocks until every stage finished or one of them stopped
+    void wait_for(Job& job);
+    // collects status changes of all jobs without blocking
+    void reap();
+
+    // "[1]+  Done                    sleep 1", finished jobs are removed once reported
+    std::vector<std::string> take_notifications();
+    std::string describe(const Job& job);
+
+private:
+    std::list<Job> jobs; // in creation order, stable addresses
+
+    void record(Process& proc, int status, const struct rusage& usage);
+};
+
+
+#endif //SHELL_STARTER_CPP_JOBS_H
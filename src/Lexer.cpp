@@ -0,0 +1,265 @@
+#include "Lexer.hpp"
+
+#include <cstring>
+#include <string>
+
+// Tokenizer, the same quoting rules the old per-char parse_arguments had
+
+bool Lexer::is_meta(char c) {
+    switch (c) {
+        case ' ': case '\t': case '\n': case '\r':
+        case '|': case '&': case ';': case '(': case ')': case '<': case '>':
+            return true;
+        default:
+            return false;
+    }
+}
+
+Token Lexer::next() {
+    // blanks and comments
+    while (pos < input.size()) {
+        char c = input[pos];
+        if (c == ' ' || c == '\t' || c == '\r') {
+            pos++;
+        } else if (c == '\\' && pos + 1 < input.size() && input[pos + 1] == '\n') {
+            pos += 2; // line continuation, as if both weren't there
+        } else if (c == '#') {
+            const void* nl = std::memchr(input.data() + pos, '\n', input.size() - pos);
+            pos = nl ? static_cast<const char*>(nl) - input.data() : input.size();
+        } else {
+            break;
+        }
+    }
+    if (pos >= input.size()) return {Token::End, {}, input.substr(pos)};
+
+    size_t start = pos;
+    auto op = [&](Token::Kind kind, size_t len, int fd = -1) {
+        pos += len;
+        return Token{kind, {}, input.substr(start, pos - start), fd};
+    };
+    char next_c = pos + 1 < input.size() ? input[pos + 1] : '\0';
+
+    switch (input[pos]) {
+        case '\n': return op(Token::Newline, 1);
+        case ';': return op(Token::Semi, 1);
+        case '(': return op(Token::LParen, 1);
+        case ')': return op(Token::RParen, 1);
+        case '|': return next_c == '|' ? op(Token::OrIf, 2) : op(Token::Pipe, 1);
+        case '&':
+            if (next_c == '&') return op(Token::AndIf, 2);
+            if (next_c == '>') return redirect_op(start, -1);
+            return op(Token::Amp, 1);
+        case '<':
+        case '>':
+            return redirect_op(start, -1);
+        default: break;
+    }
+
+    Token token = word();
+    if (token.kind != Token::Word || token.quoted || pos >= input.size()) return token;
+
+    // 2>file: a number right before a redirection names the fd
+    char after = input[pos];
+    if ((after == '<' || after == '>') && token.raw.size() <= 4 &&
+        token.raw.find_first_not_of("0123456789") == std::string_view::npos) {
+        int fd = 0;
+        for (char d : token.raw) fd = fd * 10 + (d - '0');
+        return redirect_op(token.raw.data() - input.data(), fd);
+    }
+    return token;
+}
+
+Token Lexer::redirect_op(size_t start, int fd) {
+    std::string_view rest = input.substr(pos);
+    Token::Kind kind;
+    size_t len;
+
+    // longest operator first
+    if (rest.starts_with("<<<")) kind = Token::TLess, len = 3;
+    else if (rest.starts_with("<<-")) kind = Token::DLessDash, len = 3;
+    else if (rest.starts_with("<<")) kind = Token::DLess, len = 2;
+    else if (rest.starts_with("<&")) kind = Token::LessAnd, len = 2;
+    else if (rest.starts_with("<")) kind = Token::Less, len = 1;
+    else if (rest.starts_with(">>")) kind = Token::DGreat, len = 2;
+    else if (rest.starts_with(">&")) kind = Token::GreatAnd, len = 2;
+    else if (rest.starts_with(">")) kind = Token::Great, len = 1;
+    else if (rest.starts_with("&>>")) kind = Token::AndDGreat, len = 3;
+    else kind = Token::AndGreat, len = 2;
+
+    pos += len;
+    return {kind, {}, input.substr(start, pos - start), fd};
+}
+
+bool Lexer::heredoc(std::string_view delim, bool strip_tabs, std::string_view& body) {
+    size_t start = pos;
+    std::string stripped;
+
+    while (pos < input.size()) {
+        size_t nl = input.find('\n', pos);
+        size_t end = nl == std::string_view::npos ? input.size() : nl;
+        std::string_view line = input.substr(pos, end - pos);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+        if (strip_tabs) {
+            size_t tabs = line.find_first_not_of('\t');
+            line.remove_prefix(tabs == std::string_view::npos ? line.size() : tabs);
+        }
+
+        if (line == delim) {
+            if (strip_tabs) {
+                char* copy = static_cast<char*>(arena->allocate(stripped.size() + 1, 1));
+                stripped.copy(copy, stripped.size());
+                copy[stripped.size()] = '\0';
+                body = {copy, stripped.size()};
+            } else {
+                body = input.substr(start, pos - start);
+            }
+            pos = nl == std::string_view::npos ? input.size() : nl + 1;
+            return true;
+        }
+
+        if (strip_tabs) {
+            stripped.append(line);
+            stripped += '\n';
+        }
+        pos = nl == std::string_view::npos ? input.size() : nl + 1;
+    }
+    return false;
+}
+
+size_t Lexer::closing_bracket(std::string_view text, size_t open) {
+    char opening = text[open];
+    char closing = opening == '(' ? ')' : '}';
+    int depth = 0;
+    for (size_t i = open; i < text.size(); ++i) {
+        char c = text[i];
+        if (c == '\\') {
+            i++;
+        } else if (c == '\'') {
+            i = text.find('\'', i + 1);
+            if (i == std::string_view::npos) break;
+        } else if (c == '"') {
+            while (++i < text.size() && text[i] != '"') {
+                if (text[i] == '\\') i++;
+                // a ) inside "$(...)" doesn't close anything out here
+                else if (text[i] == '$' && i + 1 < text.size() && (text[i + 1] == '(' || text[i + 1] == '{')) {
+                    i = closing_bracket(text, i + 1);
+                    if (i == std::string_view::npos) return i;
+                }
+            }
+        } else if (c == '`') {
+            i = closing_backquote(text, i);
+            if (i == std::string_view::npos) break;
+        } else if (c == opening) {
+            depth++;
+        } else if (c == closing && --depth == 0) {
+            return i;
+        }
+    }
+    return std::string_view::npos;
+}
+
+size_t Lexer::closing_backquote(std::string_view text, size_t open) {
+    for (size_t i = open + 1; i < text.size(); ++i) {
+        if (text[i] == '\\') i++;
+        else if (text[i] == '`') return i;
+    }
+    return std::string_view::npos;
+}
+
+Token Lexer::word() {
+    size_t start = pos;
+    bool quoted = false;
+    bool joined = false; // has a line continuation, unquote() takes it out
+    bool expand = false;
+
+    while (pos < input.size()) {
+        char c = input[pos];
+        if (c == '\\') {
+            if (pos + 1 >= input.size()) return {Token::Unterminated, {}, input.substr(start)};
+            if (input[pos + 1] == '\n') joined = true;
+            else quoted = true;
+            pos += 2;
+        } else if (c == '\'') {
+            quoted = true;
+            size_t close = input.find('\'', pos + 1);
+            if (close == std::string_view::npos) return {Token::Unterminated, {}, input.substr(start)};
+            pos = close + 1;
+        } else if (c == '"') {
+            quoted = true;
+            pos++;
+            while (pos < input.size() && input[pos] != '"') {
+                char q = input[pos];
+                size_t skip_to = pos;
+                if (q == '$' && pos + 1 < input.size() && (input[pos + 1] == '(' || input[pos + 1] == '{')) {
+                    skip_to = closing_bracket(input, pos + 1);
+                } else if (q == '`') {
+                    skip_to = closing_backquote(input, pos);
+                }
+                if (skip_to == std::string_view::npos) return {Token::Unterminated, {}, input.substr(start)};
+                if (q == '$' || q == '`') expand = true;
+                pos = q == '\\' ? pos + 2 : skip_to + 1;
+            }
+            if (pos >= input.size()) return {Token::Unterminated, {}, input.substr(start)};
+            pos++;
+        } else if (c == '$') {
+            expand = true;
+            pos++;
+            // ${name:-a b} and $(cmd | cmd) are one word, blanks, operators and all
+            if (pos < input.size() && (input[pos] == '{' || input[pos] == '(')) {
+                size_t close = closing_bracket(input, pos);
+                if (close == std::string_view::npos) return {Token::Unterminated, {}, input.substr(start)};
+                pos = close + 1;
+            }
+        } else if (c == '`') {
+            expand = true;
+            size_t close = closing_backquote(input, pos);
+            if (close == std::string_view::npos) return {Token::Unterminated, {}, input.substr(start)};
+            pos = close + 1;
+        } else if (is_meta(c)) {
+            break;
+        } else {
+            if (c == '*' || c == '?' || c == '[') expand = true; // a glob pattern
+            pos++;
+        }
+    }
+
+    std::string_view raw = input.substr(start, pos - start);
+    return {Token::Word, quoted || joined ? unquote(raw) : raw, raw, -1, quoted, expand};
+}
+
+std::string_view Lexer::unquote(std::string_view raw) {
+    // never longer than the raw word
+    char* out = static_cast<char*>(arena->allocate(raw.size() + 1, 1));
+    size_t n = 0;
+    char quote = '\0';
+
+    for (size_t i = 0; i < raw.size(); ++i) {
+        char c = raw[i];
+        if (quote == '\'') {
+            // everything is literal until the next '
+            if (c == '\'') quote = '\0';
+            else out[n++] = c;
+        } else if (quote == '"') {
+            // only \" \\ \$ and \` are escapes, other backslashes stay; \<newline> joins lines
+            if (c == '\\') {
+                char e = raw[++i];
+                if (e == '\n') continue;
+                if (e != '"' && e != '\\' && e != '$' && e != '`') out[n++] = '\\';
+                out[n++] = e;
+            } else if (c == '"') {
+                quote = '\0';
+            } else {
+                out[n++] = c;
+            }
+        } else if (c == '\\') {
+            if (raw[++i] != '\n') out[n++] = raw[i];
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+        } else {
+            out[n++] = c;
+        }
+    }
+    out[n] = '\0';
+    return {out, n};
+}
@@ -0,0 +1,75 @@
+#ifndef SHELL_STARTER_CPP_LEXER_H
+#define SHELL_STARTER_CPP_LEXER_H
+
+#include <memory_resource>
+#include <string_view>
+
+struct Token {
+    enum Kind {
+        Word,
+        Pipe,      // |
+        OrIf,      // ||
+        Amp,       // &
+        AndIf,     // &&
+        Semi,      // ;
+        LParen,    // (
+        RParen,    // )
+        Less,      // <
+        Great,     // >
+        DGreat,    // >>
+        LessAnd,   // <&
+        GreatAnd,  // >&
+        AndGreat,  // &>
+        AndDGreat, // &>>
+        DLess,     // <<
+        DLessDash, // <<-
+        TLess,     // <<<
+        Newline,
+        End,
+        Unterminated, // input ended inside quotes or after a backslash
+    };
+
+    Kind kind;
+    std::string_view text; // Word: with quotes and escapes removed
+    std::string_view raw;  // as written in the input
+    int fd = -1;           // redirection: io number written before it, -1 for the default
+    bool quoted = false;   // Word: had quotes or escapes
+    bool expand = false;   // Word: has a $ or ` outside single quotes, or an unquoted * ? [
+};
+
+// Single pass tokenizer over one input, tokens point into the input.
+// Only words with quotes or escapes are copied, their unquoted text goes to the arena.
+class Lexer {
+public:
+    Lexer(std::string_view input, std::pmr::memory_resource* arena) : input(input), arena(arena) {}
+
+    Token next();
+    // offset of the next unread byte
+    size_t offset() const { return pos; }
+
+    // here-doc body: the lines up to the one that is exactly delim, read right after a newline token.
+    // Points into the input unless strip_tabs (<<-) had to remove leading tabs. False when delim never comes.
+    bool heredoc(std::string_view delim, bool strip_tabs, std::string_view& body);
+
+    static bool is_redirect(Token::Kind kind) { return kind >= Token::Less && kind <= Token::TLess; }
+    // the '}' or ')' closing the '{' or '(' at open (of "${" / "$("), skipping quotes, backquotes and nested
+    // pairs; npos when there is none
+    static size_t closing_bracket(std::string_view text, size_t open);
+    // the '`' closing the one at open, npos when there is none
+    static size_t closing_backquote(std::string_view text, size_t open);
+
+private:
+    std::string_view input;
+    std::pmr::memory_resource* arena;
+    size_t pos = 0;
+
+    Token word();
+    // redirection operator at pos, after an optional io number
+    Token redirect_op(size_t start, int fd);
+    std::string_view unquote(std::string_view raw);
+
+    static bool is_meta(char c);
+};
+
+
+#endif //SHELL_STARTER_CPP_LEXER_H
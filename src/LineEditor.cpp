@@ -0,0 +1,566 @@
+#include "LineEditor.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+
+// Line editor: edit buffer + cursor, rendered as a diff against the previous screen state
+
+namespace {
+    bool is_continuation(char c) {
+        return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+    }
+
+    void append_csi(std::string& out, size_t n, char final) {
+        out += "\33[";
+        out += std::to_string(n);
+        out += final;
+    }
+}
+
+void LineEditor::set_raw_mode(bool enable) {
+    static struct termios oldt;
+    static bool firstCall = true;
+
+    if (firstCall) {
+        tcgetattr(STDIN_FILENO, &oldt);
+        firstCall = false;
+    }
+
+    if (enable) {
+        struct termios newt = oldt;
+
+        // ICANON disables line buffering (Canonical mode)
+        // ECHO disables printing the character back to the screen
+        // ISIG off, Ctrl-C / Ctrl-Z arrive as keys instead of signals
+        newt.c_lflag &= ~(ICANON | ECHO | ISIG);
+        newt.c_cc[VMIN] = 1;
+        newt.c_cc[VTIME] = 0;
+
+        tcsetattr(STDIN_FILENO, TCSANOW, &newt);
+    } else {
+        // restore original
+        tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
+    }
+}
+
+size_t LineEditor::width(std::string_view text) {
+    // one column per UTF-8 code point
+    size_t w = 0;
+    for (char c : text) {
+        if (!is_continuation(c)) w++;
+    }
+    return w;
+}
+
+bool LineEditor::read_line(std::string_view new_prompt, std::string& line) {
+    prompt = new_prompt;
+    buf.clear();
+    pos = 0;
+    shown.clear();
+    shown_cursor = 0;
+    tabs = 0;
+    hist_back = 0;
+    saved_line.clear();
+    done = false;
+    eof = false;
+    cancelled = false;
+    searching = false;
+    answer = nullptr;
+    paged.clear();
+    below = false;
+
+    struct winsize ws{};
+    cols = (ioctl(out_fd, TIOCGWINSZ, &ws) == 0) ? ws.ws_col : 0;
+
+    set_raw_mode(true); // all individual keystrokes
+
+    refresh();
+    flush();
+
+    while (!done) {
+        // keys left over from the last batch (rest of a paste) come first
+        consume();
+        if (done) break;
+        flush();
+
+        // wait for keys and for whatever else the shell watches (finished jobs, ...)
+        std::vector<pollfd> fds{{in_fd, POLLIN, 0}};
+        for (const auto& [fd, handler] : watched) fds.push_back({fd, POLLIN, 0});
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (size_t i = 1; i < fds.size(); ++i) {
+            if (fds[i].revents & POLLIN) watched[i - 1].second();
+        }
+        if (!(fds[0].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+        char chunk[4096];
+        ssize_t n = read(in_fd, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            eof = buf.empty();
+            break;
+        }
+        pending.append(chunk, n);
+    }
+
+    // leave the cursor below the input
+    move_cursor(shown_cursor, width(shown));
+    if (cancelled) {
+        out += "^C";
+        buf.clear();
+    }
+    out += "\r\n";
+    flush();
+
+    set_raw_mode(false);
+    line = buf;
+    return !eof;
+}
+
+void LineEditor::consume() {
+    size_t i = 0;
+    while (i < pending.size() && !done) {
+        size_t used = handle_key(i);
+        if (used == 0) break; // incomplete escape sequence, wait for the rest
+        i += used;
+    }
+    pending.erase(0, i);
+    refresh();
+}
+
+size_t LineEditor::handle_key(size_t i) {
+    if (answer || !paged.empty()) return handle_modal_key(i);
+
+    char c = pending[i];
+
+    if (c != '\t') {
+        tabs = 0;
+        if (on_key) on_key();
+    }
+
+    size_t used = 0;
+    if (searching && handle_search_key(i, used)) return used;
+
+    switch (c) {
+        case '\r':
+        case '\n': // ENTER
+            pos = buf.size();
+            done = true;
+            return 1;
+        case '\t': // TAB
+            if (on_tab) on_tab(*this, ++tabs);
+            return 1;
+        case 127: // BACKSPACE
+        case 8:   // Ctrl-H
+            erase_before();
+            return 1;
+        case 1: // Ctrl-A
+            pos = 0;
+            return 1;
+        case 5: // Ctrl-E
+            pos = buf.size();
+            return 1;
+        case 2: // Ctrl-B
+            move_left();
+            return 1;
+        case 6: // Ctrl-F
+            move_right();
+            return 1;
+        case 3: // Ctrl-C, drop the line
+            pos = buf.size();
+            cancelled = true;
+            done = true;
+            return 1;
+        case 4: // Ctrl-D, EOF on an empty line
+            if (buf.empty()) {
+                eof = true;
+                done = true;
+                return 1;
+            }
+            erase_at();
+            return 1;
+        case 11: // Ctrl-K
+            buf.erase(pos);
+            return 1;
+        case 21: // Ctrl-U
+            buf.erase(0, pos);
+            pos = 0;
+            return 1;
+        case 23: { // Ctrl-W, previous word
+            size_t start = pos;
+            while (start > 0 && buf[start - 1] == ' ') start--;
+            while (start > 0 && buf[start - 1] != ' ') start--;
+            buf.erase(start, pos - start);
+            pos = start;
+            return 1;
+        }
+        case 18: // Ctrl-R
+            start_search();
+            return 1;
+        case 12: // Ctrl-L
+            out += "\33[H\33[2J";
+            shown.clear();
+            shown_cursor = 0;
+            return 1;
+        case 27: { // escape sequence
+            if (i + 1 >= pending.size()) return 0;
+            char kind = pending[i + 1];
+            if (kind == '[') {
+                // CSI: parameters then one final byte in 0x40-0x7E
+                size_t j = i + 2;
+                while (j < pending.size() && (pending[j] < 0x40 || pending[j] > 0x7E)) j++;
+                if (j >= pending.size()) return 0;
+                handle_csi(std::string_view(pending).substr(i + 2, j - i - 2), pending[j]);
+                return j - i + 1;
+            }
+            if (kind == 'O') {
+                // SS3, what some terminals send for arrows / home / end
+                if (i + 2 >= pending.size()) return 0;
+                handle_csi("", pending[i + 2]);
+                return 3;
+            }
+            return 2; // Alt + key, not bound
+        }
+        default:
+            if (static_cast<unsigned char>(c) < 32) return 1; // unbound control key
+
+            // normal char, a run of them is inserted at once
+            size_t j = i + 1;
+            while (j < pending.size() && (static_cast<unsigned char>(pending[j]) >= 32 && pending[j] != 127)) j++;
+            buf.insert(pos, pending, i, j - i);
+            pos += j - i;
+            return j - i;
+    }
+}
+
+void LineEditor::handle_csi(std::string_view params, char final) {
+    switch (final) {
+        case 'A': // UP ARROW
+            history_step(1);
+            break;
+        case 'B': // DOWN ARROW
+            history_step(-1);
+            break;
+        case 'C': // RIGHT ARROW
+            move_right();
+            break;
+        case 'D': // LEFT ARROW
+            move_left();
+            break;
+        case 'H': // HOME
+            pos = 0;
+            break;
+        case 'F': // END
+            pos = buf.size();
+            break;
+        case '~':
+            if (params == "1" || params == "7") pos = 0;
+            else if (params == "4" || params == "8") pos = buf.size();
+            else if (params == "3") erase_at(); // DELETE
+            break;
+        default:
+            break;
+    }
+}
+
+void LineEditor::move_left() {
+    if (pos == 0) return;
+    do pos--; while (pos > 0 && is_continuation(buf[pos]));
+}
+
+void LineEditor::move_right() {
+    if (pos == buf.size()) return;
+    do pos++; while (pos < buf.size() && is_continuation(buf[pos]));
+}
+
+void LineEditor::erase_before() {
+    size_t end = pos;
+    move_left();
+    buf.erase(pos, end - pos);
+}
+
+void LineEditor::erase_at() {
+    size_t start = pos;
+    move_right();
+    buf.erase(start, pos - start);
+    pos = start;
+}
+
+void LineEditor::history_step(int direction) {
+    if (!history_size || !history_entry) return;
+    size_t size = history_size();
+
+    size_t target = hist_back + direction;
+    if (direction > 0 && hist_back >= size) return;
+    if (direction < 0 && hist_back == 0) return;
+
+    if (hist_back == 0) saved_line = buf;
+    hist_back = target;
+
+    if (hist_back == 0) {
+        buf = saved_line;
+    } else {
+        buf = history_entry(size - hist_back);
+    }
+    pos = buf.size();
+}
+
+void LineEditor::start_search() {
+    if (!history_size || !history_search) return;
+    searching = true;
+    search_failed = false;
+    query.clear();
+    match = history_size();
+    search_line = buf;
+    search_pos = pos;
+}
+
+void LineEditor::search_from(size_t before) {
+    size_t found = history_search(query, before);
+    search_failed = found == SIZE_MAX;
+    if (search_failed) {
+        bell();
+        return;
+    }
+
+    // keep showing the last match when nothing older fits
+    match = found;
+    buf = history_entry(match);
+    pos = std::min(buf.find(query), buf.size());
+}
+
+bool LineEditor::handle_search_key(size_t i, size_t& used) {
+    char c = pending[i];
+    used = 1;
+
+    switch (c) {
+        case 18: // Ctrl-R, next older match
+            if (query.empty() || search_failed) {
+                if (!query.empty()) bell();
+                return true;
+            }
+            search_from(match);
+            return true;
+        case 127: // BACKSPACE
+        case 8: {
+            if (query.empty()) return true;
+            size_t end = query.size();
+            do end--; while (end > 0 && is_continuation(query[end]));
+            query.erase(end);
+            if (query.empty()) {
+                search_failed = false;
+                return true;
+            }
+            search_from(history_size());
+            return true;
+        }
+        case 7: // Ctrl-G, back to the line from before the search
+            end_search(false);
+            return true;
+        default: {
+            if (static_cast<unsigned char>(c) < 32) {
+                // anything else accepts the match and then does what it normally does
+                end_search(true);
+                return false;
+            }
+
+            // a pasted run of characters is searched once
+            size_t j = i + 1;
+            while (j < pending.size() && (static_cast<unsigned char>(pending[j]) >= 32 && pending[j] != 127)) j++;
+            query.append(pending, i, j - i);
+            used = j - i;
+            // the current match may still contain the longer query
+            search_from(search_failed ? match : match + 1);
+            return true;
+        }
+    }
+}
+
+void LineEditor::end_search(bool keep) {
+    searching = false;
+    if (!keep) {
+        buf = search_line;
+        pos = search_pos;
+        return;
+    }
+    // UP / DOWN continue from the match
+    if (match < history_size()) {
+        if (hist_back == 0) saved_line = search_line;
+        hist_back = history_size() - match;
+    }
+}
+
+void LineEditor::watch(int fd, std::function<void()> handler) {
+    watched.emplace_back(fd, std::move(handler));
+}
+
+void LineEditor::insert(std::string_view text) {
+    buf.insert(pos, text);
+    pos += text.size();
+    tabs = 0;
+}
+
+void LineEditor::replace(size_t from, std::string_view text) {
+    from = std::min(from, pos);
+    buf.replace(from, pos - from, text);
+    pos = from + text.size();
+    tabs = 0;
+}
+
+void LineEditor::set_buffer(std::string_view text) {
+    buf = text;
+    pos = buf.size();
+    tabs = 0;
+}
+
+void LineEditor::leave_input() {
+    if (below) return;
+    // the input typed so far in this batch stays visible above what follows
+    refresh();
+    move_cursor(shown_cursor, width(shown));
+    out += "\r\n";
+
+    // nothing of the prompt is on screen anymore
+    shown.clear();
+    shown_cursor = 0;
+    tabs = 0;
+    below = true;
+}
+
+void LineEditor::show_below(std::string_view text) {
+    leave_input();
+    out += text;
+    out += "\r\n";
+}
+
+void LineEditor::ask(std::string_view question, std::function<void(bool yes)> on_answer) {
+    leave_input();
+    out += question;
+    answer = std::move(on_answer);
+}
+
+void LineEditor::page(std::vector<std::string> lines) {
+    leave_input();
+    paged = std::move(lines);
+    paged_next = 0;
+
+    struct winsize ws{};
+    size_t rows = (ioctl(out_fd, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 1) ? ws.ws_row : 24;
+    show_page(rows - 1);
+}
+
+void LineEditor::show_page(size_t lines) {
+    for (; lines > 0 && paged_next < paged.size(); --lines) {
+        out += paged[paged_next++];
+        out += "\r\n";
+    }
+    if (paged_next < paged.size()) {
+        out += "--More--";
+        return;
+    }
+    paged.clear();
+}
+
+size_t LineEditor::handle_modal_key(size_t i) {
+    char c = pending[i];
+    size_t used = 1;
+    if (c == 27) {
+        // a whole escape sequence counts as one key
+        if (i + 1 >= pending.size()) return 0;
+        used = 2;
+        if (pending[i + 1] == '[' || pending[i + 1] == 'O') {
+            size_t j = i + 2;
+            while (j < pending.size() && (pending[j] < 0x40 || pending[j] > 0x7E)) j++;
+            if (j >= pending.size()) return 0;
+            used = j - i + 1;
+        }
+    }
+
+    if (answer) {
+        bool yes = c == 'y' || c == 'Y' || c == ' ';
+        bool no = c == 'n' || c == 'N' || c == 'q' || c == 'Q' || c == 3 || c == 127 || c == 27;
+        if (!yes && !no) {
+            bell();
+            return used;
+        }
+        out += "\r\n";
+        auto on_answer = std::move(answer);
+        answer = nullptr;
+        if (yes) on_answer(true);
+        else on_answer(false);
+    } else {
+        out += "\r\33[K"; // --More--
+        struct winsize ws{};
+        size_t rows = (ioctl(out_fd, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 1) ? ws.ws_row : 24;
+        if (c == ' ') show_page(rows - 1);
+        else if (c == '\r' || c == '\n') show_page(1);
+        else paged.clear();
+    }
+
+    return used;
+}
+
+void LineEditor::move_cursor(size_t from, size_t to) {
+    if (from == to) return;
+
+    size_t from_row = cols ? from / cols : 0;
+    size_t from_col = cols ? from % cols : from;
+    size_t to_row = cols ? to / cols : 0;
+    size_t to_col = cols ? to % cols : to;
+
+    if (to_row < from_row) append_csi(out, from_row - to_row, 'A');
+    if (to_row > from_row) append_csi(out, to_row - from_row, 'B');
+    if (to_col < from_col) append_csi(out, from_col - to_col, 'D');
+    if (to_col > from_col) append_csi(out, to_col - from_col, 'C');
+}
+
+void LineEditor::refresh() {
+    if (answer || !paged.empty()) return; // drawn again once the question / pager is over
+
+    below = false;
+    std::string lead = prompt;
+    if (searching) lead = (search_failed ? "(failed reverse-i-search)`" : "(reverse-i-search)`") + query + "': ";
+
+    std::string next = lead + buf;
+    size_t next_cursor = width(lead) + width(std::string_view(buf).substr(0, pos));
+
+    // keep whatever is already right on screen
+    size_t same = 0;
+    while (same < next.size() && same < shown.size() && next[same] == shown[same]) same++;
+    while (same > 0 && same < next.size() && is_continuation(next[same])) same--;
+
+    size_t cur = shown_cursor;
+    if (same < shown.size() || same < next.size()) {
+        size_t same_col = width(std::string_view(next).substr(0, same));
+        move_cursor(cur, same_col);
+        cur = same_col;
+
+        if (same < next.size()) {
+            out.append(next, same);
+            cur = width(next);
+            // don't leave the terminal in its pending wrap state at the right margin
+            if (cols && cur % cols == 0) out += "\r\n";
+        }
+        if (same < shown.size()) out += "\33[J"; // old text was longer
+    }
+
+    move_cursor(cur, next_cursor);
+    shown = std::move(next);
+    shown_cursor = next_cursor;
+}
+
+void LineEditor::flush() {
+    size_t written = 0;
+    while (written < out.size()) {
+        ssize_t n = write(out_fd, out.data() + written, out.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        written += n;
+    }
+    out.clear();
+}
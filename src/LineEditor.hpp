@@ -0,0 +1,121 @@
+#ifndef SHELL_STARTER_CPP_LINEEDITOR_H
+#define SHELL_STARTER_CPP_LINEEDITOR_H
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+// Raw-mode line editor.
+// Input is read in bulk and every key of a batch is applied to the edit buffer before anything is drawn,
+// the renderer then emits only the difference with what is on screen in a single write().
+class LineEditor {
+public:
+    explicit LineEditor(int in_fd = STDIN_FILENO, int out_fd = STDOUT_FILENO) : in_fd(in_fd), out_fd(out_fd) {}
+
+    // shows prompt and edits until ENTER, false on EOF
+    bool read_line(std::string_view prompt, std::string& line);
+
+    // TAB, tabs = number of consecutive TAB presses including this one
+    std::function<void(LineEditor&, int tabs)> on_tab;
+    // any other key, before it is handled (a completion still running is out of date)
+    std::function<void()> on_key;
+    // UP / DOWN, entry 0 is the oldest
+    std::function<size_t()> history_size;
+    std::function<std::string_view(size_t)> history_entry;
+    // Ctrl-R, newest entry with index < before containing query, SIZE_MAX when there is none
+    std::function<size_t(std::string_view query, size_t before)> history_search;
+
+    // fd polled next to the terminal while editing, handler runs whenever it is readable
+    void watch(int fd, std::function<void()> handler);
+
+    // for the callbacks
+    const std::string& buffer() const { return buf; }
+    size_t cursor() const { return pos; }
+    // the last read_line ended with Ctrl-C
+    bool was_cancelled() const { return cancelled; }
+    void insert(std::string_view text);
+    // text instead of the buffer from offset from up to the cursor
+    void replace(size_t from, std::string_view text);
+    void set_buffer(std::string_view text);
+    void bell() { out += '\a'; }
+    // text on its own lines below the input, prompt and input are drawn again under it
+    void show_below(std::string_view text);
+    // "question" below the input, the next key answers it: y / Y / SPACE yes, n / N / q / Ctrl-C / DEL no
+    void ask(std::string_view question, std::function<void(bool yes)> answer);
+    // lines below the input a screenful at a time, --More-- in between: SPACE next page, ENTER next line, else stop
+    void page(std::vector<std::string> lines);
+
+private:
+    int in_fd;
+    int out_fd;
+    std::vector<std::pair<int, std::function<void()>>> watched;
+
+    std::string prompt;
+    std::string buf;
+    size_t pos = 0; // byte offset of the cursor in buf
+
+    // what the terminal shows right now
+    std::string shown;       // prompt + buffer as last drawn
+    size_t shown_cursor = 0; // column of the cursor, counted from the start of the prompt
+    size_t cols = 0;         // terminal width, 0 = unknown (no wrapping)
+
+    // an open question or pager owns the keys, the input is drawn again once it is over
+    std::function<void(bool)> answer;
+    std::vector<std::string> paged;
+    size_t paged_next = 0; // first line of paged not shown yet
+    bool below = false;    // the cursor is on a fresh line under the input, which isn't drawn
+
+    std::string out;     // escape sequences + text for the current batch
+    std::string pending; // read but not handled yet: partial escape sequence, lines after a pasted ENTER
+
+    int tabs = 0;
+    size_t hist_back = 0;   // 0 = editing a new line, n = n-th most recent history entry
+    std::string saved_line; // new line while browsing history
+    bool done = false;
+    bool eof = false;
+    bool cancelled = false; // Ctrl-C
+
+    // reverse incremental search, buf holds the match while searching
+    bool searching = false;
+    bool search_failed = false;
+    std::string query;
+    size_t match = 0;        // history index of the shown match, history size when there is none yet
+    std::string search_line; // buffer + cursor from before Ctrl-R, back on Ctrl-G
+    size_t search_pos = 0;
+
+    // handles as much of pending as possible, an incomplete escape sequence stays in pending
+    void consume();
+    // length of the key at pending[i], 0 when more bytes are needed
+    size_t handle_key(size_t i);
+    void handle_csi(std::string_view params, char final);
+    // key while a question or the pager is open
+    size_t handle_modal_key(size_t i);
+    void show_page(size_t lines);
+    // ends the input's line, what comes next is written under it
+    void leave_input();
+
+    void move_left();
+    void move_right();
+    void erase_before();
+    void erase_at();
+    void history_step(int direction);
+
+    // key while searching, false when it ends the search and has to be handled as a normal key
+    bool handle_search_key(size_t i, size_t& used);
+    void start_search();
+    void search_from(size_t before);
+    void end_search(bool keep);
+
+    void refresh();
+    void move_cursor(size_t from, size_t to);
+    void flush();
+
+    static size_t width(std::string_view text);
+    static void set_raw_mode(bool enable);
+};
+
+
+#endif //SHELL_STARTER_CPP_LINEEDITOR_H
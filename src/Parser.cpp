@@ -0,0 +1,220 @@
+#include "Parser.hpp"
+
+// Parser, one token of lookahead, nothing is copied out of the input
+
+const Token& Parser::peek() {
+    if (!have_tok) {
+        tok = lexer.next();
+        have_tok = true;
+        if (tok.kind == Token::Newline && !heredocs.empty() && !read_heredocs()) tok = {Token::End, {}, {}};
+    }
+    return tok;
+}
+
+bool Parser::read_heredocs() {
+    for (const auto& pending : heredocs) {
+        ast::Redirect& r = pending.cmd->redirects[pending.index];
+        std::string_view body;
+        if (!lexer.heredoc(r.target.text, pending.strip_tabs, body)) {
+            missing_delimiter = r.target.text; // still to come
+            return false;
+        }
+        // only an unquoted delimiter has its body expanded
+        r.target.expand = !r.target.quoted && body.find_first_of("$`") != std::string_view::npos;
+        r.target.text = body;
+    }
+    heredocs.clear();
+    return true;
+}
+
+Token Parser::take() {
+    peek();
+    have_tok = false;
+    return tok;
+}
+
+void Parser::skip_newlines() {
+    while (peek().kind == Token::Newline) take();
+}
+
+bool Parser::fail(const Token& at) {
+    if (status == Ok) {
+        // running out of input is not an error yet, more lines may follow
+        status = (at.kind == Token::End || at.kind == Token::Unterminated) ? Incomplete : Error;
+        error_at = at.kind == Token::Newline ? "newline" : at.kind == Token::End ? "end of file" : at.raw;
+    }
+    return false;
+}
+
+bool Parser::is_reserved(const Token& t, std::string_view word) const {
+    return t.kind == Token::Word && !t.quoted && t.raw == word;
+}
+
+namespace {
+    // source text from the start of first to the end of last
+    std::string_view span(std::string_view first, std::string_view last) {
+        return {first.data(), static_cast<size_t>(last.data() + last.size() - first.data())};
+    }
+}
+
+Parser::Status Parser::parse(ast::List*& result) {
+    result = list(false);
+    if (status == Ok && peek().kind != Token::End) fail(peek()); // a ')' or '}' nobody opened
+    if (status == Ok && !heredocs.empty()) fail(peek());       // here-doc without its body
+    if (!result) result = make<ast::List>();
+    return status;
+}
+
+ast::List* Parser::list(bool nested) {
+    ast::List* result = make<ast::List>();
+    skip_newlines();
+
+    while (true) {
+        const Token& t = peek();
+        if (t.kind == Token::End) break;
+        if (nested && (t.kind == Token::RParen || is_reserved(t, "}"))) break;
+
+        ast::AndOr* item = and_or();
+        if (!item) return nullptr;
+
+        bool background = false;
+        const Token& sep = peek();
+        if (sep.kind == Token::Amp || sep.kind == Token::Semi) {
+            background = sep.kind == Token::Amp;
+            take();
+        } else if (sep.kind == Token::Newline) {
+            take();
+        } else if (sep.kind != Token::End && !(nested && (sep.kind == Token::RParen || is_reserved(sep, "}")))) {
+            fail(sep);
+            return nullptr;
+        }
+        result->items.push_back({item, background});
+        skip_newlines();
+    }
+
+    if (nested && result->items.empty()) {
+        fail(peek());
+        return nullptr;
+    }
+    return result;
+}
+
+ast::AndOr* Parser::and_or() {
+    ast::AndOr* result = make<ast::AndOr>();
+    result->first = pipeline();
+    if (!result->first) return nullptr;
+    ast::Pipeline* last = result->first;
+
+    while (peek().kind == Token::AndIf || peek().kind == Token::OrIf) {
+        ast::AndOr::Op op = take().kind == Token::AndIf ? ast::AndOr::And : ast::AndOr::Or;
+        skip_newlines();
+        last = pipeline();
+        if (!last) return nullptr;
+        result->rest.emplace_back(op, last);
+    }
+
+    result->text = span(result->first->text, last->text);
+    return result;
+}
+
+ast::Pipeline* Parser::pipeline() {
+    ast::Pipeline* result = make<ast::Pipeline>();
+    std::string_view first = peek().raw;
+
+    while (true) {
+        ast::Command* cmd = command();
+        if (!cmd) return nullptr;
+        result->commands.push_back(cmd);
+
+        if (peek().kind != Token::Pipe) break;
+        take();
+        skip_newlines();
+    }
+
+    result->text = span(first, last_end);
+    return result;
+}
+
+ast::Command* Parser::command() {
+    ast::Command* cmd = make<ast::Command>();
+    const Token& t = peek();
+
+    if (t.kind == Token::LParen || is_reserved(t, "{")) {
+        bool subshell = t.kind == Token::LParen;
+        take();
+        cmd->kind = subshell ? ast::Command::Subshell : ast::Command::Group;
+        cmd->body = list(true);
+        if (!cmd->body) return nullptr;
+
+        Token close = take();
+        if (subshell ? close.kind != Token::RParen : !is_reserved(close, "}")) {
+            fail(close);
+            return nullptr;
+        }
+        last_end = close.raw;
+
+        while (Lexer::is_redirect(peek().kind)) {
+            if (!redirect(cmd)) return nullptr;
+        }
+        return cmd;
+    }
+
+    while (true) {
+        const Token& w = peek();
+        if (w.kind == Token::Word && cmd->words.empty() && ast::Command::is_assignment(w.raw)) {
+            cmd->assignments.push_back({w.text, w.raw, w.quoted, w.expand});
+            last_end = w.raw;
+            take();
+        } else if (w.kind == Token::Word) {
+            cmd->words.push_back({w.text, w.raw, w.quoted, w.expand});
+            last_end = w.raw;
+            take();
+        } else if (Lexer::is_redirect(w.kind)) {
+            if (!redirect(cmd)) return nullptr;
+        } else {
+            break;
+        }
+    }
+
+    if (cmd->words.empty() && cmd->redirects.empty() && cmd->assignments.empty()) {
+        fail(peek());
+        return nullptr;
+    }
+    return cmd;
+}
+
+bool Parser::redirect(ast::Command* cmd) {
+    Token op = take();
+    Token target = take();
+    if (target.kind != Token::Word) return fail(target);
+
+    ast::Redirect r{ast::Redirect::Out, op.fd, {target.text, target.raw, target.quoted, target.expand}};
+    bool input = false;
+    switch (op.kind) {
+        case Token::Less: r.kind = ast::Redirect::In; input = true; break;
+        case Token::DGreat: r.kind = ast::Redirect::Append; break;
+        case Token::LessAnd: r.kind = ast::Redirect::Dup; input = true; break;
+        case Token::GreatAnd: {
+            // >&file is &>file
+            bool fd_word = target.text == "-" ||
+                           (!target.text.empty() && target.text.find_first_not_of("0123456789") == std::string_view::npos);
+            r.kind = fd_word || op.fd >= 0 ? ast::Redirect::Dup : ast::Redirect::OutErr;
+            break;
+        }
+        case Token::AndGreat: r.kind = ast::Redirect::OutErr; break;
+        case Token::AndDGreat: r.kind = ast::Redirect::AppendErr; break;
+        case Token::DLess:
+        case Token::DLessDash:
+            r.kind = ast::Redirect::HereDoc;
+            input = true;
+            heredocs.push_back({cmd, cmd->redirects.size(), op.kind == Token::DLessDash});
+            break;
+        case Token::TLess: r.kind = ast::Redirect::HereString; input = true; break;
+        default: break;
+    }
+    if (r.fd < 0) r.fd = input ? 0 : 1;
+
+    cmd->redirects.push_back(r);
+    last_end = target.raw;
+    return true;
+}
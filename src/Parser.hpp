@@ -0,0 +1,159 @@
+#ifndef SHELL_STARTER_CPP_PARSER_H
+#define SHELL_STARTER_CPP_PARSER_H
+
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+#include "Lexer.hpp"
+
+// Syntax tree of one input, every node and vector lives in the arena the parser was given.
+namespace ast {
+    struct List;
+
+    struct Word {
+        std::string_view text; // quotes removed
+        std::string_view raw;  // as written
+        bool quoted = false;
+        bool expand = false; // $ or a pattern to expand before the command runs (here-doc: the body has a $)
+    };
+
+    struct Redirect {
+        enum Kind {
+            In,         // <
+            Out,        // >
+            Append,     // >>
+            Dup,        // n>&m, n<&m, target "-" closes fd
+            OutErr,     // &> (also >&file)
+            AppendErr,  // &>>
+            HereDoc,    // <<, target.text is the body
+            HereString, // <<<
+        };
+
+        Kind kind;
+        int fd; // fd that gets redirected
+        Word target;
+    };
+
+    struct Command {
+        enum Kind {
+            Simple,   // words + redirections
+            Subshell, // ( list ), always runs in a child
+            Group,    // { list; }, runs in the shell
+        };
+
+        Kind kind = Simple;
+        std::pmr::vector<Word> assignments; // NAME=value words before the command name
+        std::pmr::vector<Word> words;
+        std::pmr::vector<Redirect> redirects;
+        List* body = nullptr; // Subshell / Group
+
+        explicit Command(std::pmr::memory_resource* arena) : assignments(arena), words(arena), redirects(arena) {}
+
+        // NAME=... as written, quotes can only come after the '='
+        static bool is_assignment(std::string_view raw) {
+            size_t eq = raw.find('=');
+            if (eq == 0 || eq == std::string_view::npos) return false;
+            for (size_t i = 0; i < eq; ++i) {
+                char c = raw[i];
+                bool alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+                if (!alpha && !(i > 0 && c >= '0' && c <= '9')) return false;
+            }
+            return true;
+        }
+    };
+
+    struct Pipeline {
+        std::pmr::vector<Command*> commands;
+        std::string_view text; // source, for the job table
+
+        explicit Pipeline(std::pmr::memory_resource* arena) : commands(arena) {}
+    };
+
+    // p1 && p2 || p3 ...
+    struct AndOr {
+        enum Op { And, Or };
+
+        Pipeline* first = nullptr;
+        std::pmr::vector<std::pair<Op, Pipeline*>> rest;
+        std::string_view text;
+
+        explicit AndOr(std::pmr::memory_resource* arena) : rest(arena) {}
+    };
+
+    // items separated by ; & or newlines
+    struct List {
+        struct Item {
+            AndOr* and_or;
+            bool background;
+        };
+
+        std::pmr::vector<Item> items;
+
+        explicit List(std::pmr::memory_resource* arena) : items(arena) {}
+    };
+}
+
+// Recursive descent parser:
+//   list     : and_or ((';' | '&' | newline) and_or?)*
+//   and_or   : pipeline (('&&' | '||') newline* pipeline)*
+//   pipeline : command ('|' newline* command)*
+//   command  : assignment* (word | redirect)+ | '(' list ')' redirect* | '{' list '}' redirect*
+// Here-doc bodies are read at the newline that ends the line their << is on.
+class Parser {
+public:
+    enum Status {
+        Ok,
+        Incomplete, // valid so far but ended early (open quote, trailing &&, missing ')' ...)
+        Error,
+    };
+
+    Parser(std::string_view input, std::pmr::memory_resource* arena) : lexer(input, arena), arena(arena) {}
+
+    // whole input, list stays empty (never null) for blank input
+    Status parse(ast::List*& list);
+    // the token the syntax error was found at
+    std::string_view error_token() const { return error_at; }
+    // Incomplete because a here-doc's delimiter line hasn't come yet: that delimiter, empty otherwise
+    std::string_view heredoc_delimiter() const { return missing_delimiter; }
+
+private:
+    Lexer lexer;
+    std::pmr::memory_resource* arena;
+    Token tok{Token::End, {}, {}};
+    bool have_tok = false;
+    Status status = Ok;
+    std::string_view error_at;
+    std::string_view missing_delimiter;
+    std::string_view last_end; // raw text of the last token that belongs to the node being built
+
+    // << seen on the current line, body still to read
+    struct PendingHeredoc {
+        ast::Command* cmd;
+        size_t index; // into cmd->redirects
+        bool strip_tabs;
+    };
+    std::vector<PendingHeredoc> heredocs;
+    bool read_heredocs();
+
+    const Token& peek();
+    Token take();
+    void skip_newlines();
+    bool fail(const Token& at);
+    // '{' and '}' are only reserved as unquoted words of their own
+    bool is_reserved(const Token& t, std::string_view word) const;
+
+    ast::List* list(bool nested);
+    ast::AndOr* and_or();
+    ast::Pipeline* pipeline();
+    ast::Command* command();
+    bool redirect(ast::Command* cmd);
+
+    template<typename T>
+    T* make() {
+        return std::pmr::polymorphic_allocator<T>(arena).template new_object<T>(arena);
+    }
+};
+
+
+#endif //SHELL_STARTER_CPP_PARSER_H
@@ -0,0 +1,349 @@
+#include "PathIndex.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Snapshot of the PATH executables so startup doesn't have to scan every directory
+//
+// layout (native endianness, the magic includes the version):
+//   magic[8] | u32 dir_count
+//   per dir: u64 dev | u64 ino | i64 mtime_ns | u32 path_len | u32 name_count | u32 names_bytes
+//            | path bytes | names, each NUL terminated
+
+namespace {
+    constexpr char MAGIC[8] = {'S', 'H', 'P', 'I', 'D', 'X', '0', '1'};
+
+    template <typename T>
+    bool read_field(const char*& p, const char* end, T& out) {
+        if (static_cast<size_t>(end - p) < sizeof(T)) return false;
+        std::memcpy(&out, p, sizeof(T));
+        p += sizeof(T);
+        return true;
+    }
+
+    template <typename T>
+    void write_field(std::string& buf, T value) {
+        buf.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    int64_t mtime_of(const struct stat& st) {
+        return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    }
+}
+
+PathIndex::~PathIndex() {
+    // tasks still write into dirs
+    wait_for_scans();
+    unmap_snapshot();
+    if (event_fd >= 0) close(event_fd);
+}
+
+std::filesystem::path PathIndex::default_snapshot_path() {
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    if (xdg && *xdg) {
+        return std::filesystem::path(xdg) / "shellcpp" / "path-index";
+    }
+    const char* home = std::getenv("HOME");
+    if (home && *home) {
+        return std::filesystem::path(home) / ".cache" / "shellcpp" / "path-index";
+    }
+    return {};
+}
+
+void PathIndex::map_snapshot() {
+    if (snapshot_path.empty()) return;
+
+    int fd = open(snapshot_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+
+    struct stat st{};
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            map_base = static_cast<const char*>(addr);
+            map_size = st.st_size;
+        }
+    }
+    close(fd);
+}
+
+void PathIndex::unmap_snapshot() {
+    if (map_base) {
+        munmap(const_cast<char*>(map_base), map_size);
+        map_base = nullptr;
+        map_size = 0;
+    }
+}
+
+std::vector<PathIndex::Dir> PathIndex::read_snapshot() const {
+    std::vector<Dir> result;
+    if (!map_base || map_size < sizeof(MAGIC) || std::memcmp(map_base, MAGIC, sizeof(MAGIC)) != 0) {
+        return result;
+    }
+
+    const char* p = map_base + sizeof(MAGIC);
+    const char* end = map_base + map_size;
+
+    uint32_t dir_count;
+    if (!read_field(p, end, dir_count)) return {};
+
+    for (uint32_t i = 0; i < dir_count; ++i) {
+        Dir dir;
+        uint32_t path_len, name_count, names_bytes;
+        if (!read_field(p, end, dir.dev) || !read_field(p, end, dir.ino) || !read_field(p, end, dir.mtime_ns)
+            || !read_field(p, end, path_len) || !read_field(p, end, name_count) || !read_field(p, end, names_bytes)) {
+            return {};
+        }
+        if (static_cast<size_t>(end - p) < static_cast<size_t>(path_len) + names_bytes) return {};
+
+        dir.path.assign(p, path_len);
+        p += path_len;
+
+        // names are used straight from the mapping
+        const char* names_end = p + names_bytes;
+        dir.names.reserve(name_count);
+        while (p < names_end) {
+            const char* nul = static_cast<const char*>(std::memchr(p, '\0', names_end - p));
+            if (!nul) return {};
+            dir.names.emplace_back(p, nul - p);
+            p = nul + 1;
+        }
+        if (dir.names.size() != name_count) return {};
+
+        result.push_back(std::move(dir));
+    }
+    return result;
+}
+
+bool PathIndex::write_snapshot() const {
+    if (snapshot_path.empty()) return false;
+
+    std::string buf(MAGIC, sizeof(MAGIC));
+    write_field(buf, static_cast<uint32_t>(dirs.size()));
+
+    for (const auto& dir : dirs) {
+        uint32_t names_bytes = 0;
+        for (auto name : dir.names) names_bytes += name.size() + 1;
+
+        write_field(buf, dir.dev);
+        write_field(buf, dir.ino);
+        write_field(buf, dir.mtime_ns);
+        write_field(buf, static_cast<uint32_t>(dir.path.size()));
+        write_field(buf, static_cast<uint32_t>(dir.names.size()));
+        write_field(buf, names_bytes);
+        buf += dir.path;
+        for (auto name : dir.names) {
+            buf += name;
+            buf += '\0';
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(snapshot_path.parent_path(), ec);
+
+    // write next to the snapshot and rename, the old file stays valid for anyone who mapped it
+    std::string tmp = snapshot_path.string() + ".tmp." + std::to_string(getpid());
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+
+    size_t written = 0;
+    while (written < buf.size()) {
+        ssize_t n = write(fd, buf.data() + written, buf.size() - written);
+        if (n <= 0) break;
+        written += n;
+    }
+    close(fd);
+
+    if (written != buf.size() || rename(tmp.c_str(), snapshot_path.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+void PathIndex::scan_directory(Dir& dir) {
+    dir.names.clear();
+    dir.storage.clear();
+
+    DIR* d = opendir(dir.path.c_str());
+    if (!d) return;
+    int dfd = dirfd(d);
+
+    std::vector<size_t> offsets;
+    while (struct dirent* entry = readdir(d)) {
+        const char* name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+        if (entry->d_type == DT_DIR) continue;
+
+        // follows symlinks, like std::filesystem::is_regular_file did
+        struct stat st{};
+        if (fstatat(dfd, name, &st, 0) != 0) continue;
+        if (!S_ISREG(st.st_mode) || !(st.st_mode & S_IXUSR)) continue;
+
+        offsets.push_back(dir.storage.size());
+        dir.storage.insert(dir.storage.end(), name, name + std::strlen(name) + 1);
+    }
+    closedir(d);
+
+    // storage doesn't grow anymore, views are stable from here on
+    dir.names.reserve(offsets.size());
+    for (size_t off : offsets) {
+        dir.names.emplace_back(dir.storage.data() + off);
+    }
+}
+
+void PathIndex::load(Trie& trie) {
+    begin(nullptr);
+    merge(trie);
+}
+
+void PathIndex::start(ThreadPool& pool) {
+    if (event_fd < 0) event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    begin(&pool);
+}
+
+void PathIndex::begin(ThreadPool* pool) {
+    wait_for_scans();
+    unmap_snapshot();
+    dirs.clear();
+    ready.clear();
+    merged_dirs = 0;
+    rescanned_dirs = 0;
+
+    snapshot_path = default_snapshot_path();
+    map_snapshot();
+    std::vector<Dir> cached = read_snapshot();
+
+    const char* path_env = std::getenv("PATH");
+    if (!path_env) return;
+
+    std::vector<size_t> stale;
+    std::string_view rest(path_env);
+    while (!rest.empty()) {
+        size_t colon = rest.find(':');
+        std::string dir_path(rest.substr(0, colon));
+        rest = colon == std::string_view::npos ? std::string_view{} : rest.substr(colon + 1);
+
+        if (dir_path.empty()) continue;
+
+        bool seen = false;
+        for (const auto& dir : dirs) {
+            if (dir.path == dir_path) seen = true;
+        }
+        if (seen) continue;
+
+        struct stat st{};
+        if (stat(dir_path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) continue;
+
+        Dir dir;
+        dir.path = std::move(dir_path);
+        dir.dev = st.st_dev;
+        dir.ino = st.st_ino;
+        dir.mtime_ns = mtime_of(st);
+
+        bool reused = false;
+        for (auto& old : cached) {
+            if (old.path == dir.path && old.dev == dir.dev && old.ino == dir.ino && old.mtime_ns == dir.mtime_ns) {
+                dir.names = std::move(old.names);
+                reused = true;
+                break;
+            }
+        }
+
+        if (reused) ready.push_back(dirs.size());
+        else stale.push_back(dirs.size());
+        dirs.push_back(std::move(dir));
+    }
+
+    rescanned_dirs = stale.size();
+    snapshot_stale = rescanned_dirs > 0 || dirs.size() != cached.size();
+
+    if (event_fd >= 0 && !ready.empty()) {
+        uint64_t one = 1;
+        (void) !write(event_fd, &one, sizeof(one));
+    }
+
+    // dirs doesn't change size from here on, every task owns one element
+    for (size_t i : stale) {
+        if (!pool) {
+            scan_directory(dirs[i]);
+            ready.push_back(i);
+            continue;
+        }
+        {
+            std::lock_guard lock(scan_mutex);
+            scans_running++;
+        }
+        pool->submit([this, i]() {
+            scan_directory(dirs[i]);
+            finished(i);
+        });
+    }
+}
+
+void PathIndex::finished(size_t dir) {
+    // all under the lock: once scans_running drops to 0 the index may be destroyed
+    std::lock_guard lock(scan_mutex);
+    ready.push_back(dir);
+    if (event_fd >= 0) {
+        uint64_t one = 1;
+        (void) !write(event_fd, &one, sizeof(one));
+    }
+    scans_running--;
+    scan_done.notify_all();
+}
+
+void PathIndex::wait_for_scans() {
+    std::unique_lock lock(scan_mutex);
+    scan_done.wait(lock, [this]() { return scans_running == 0; });
+}
+
+bool PathIndex::merge(Trie& trie) {
+    if (event_fd >= 0) {
+        uint64_t count;
+        (void) !read(event_fd, &count, sizeof(count));
+    }
+
+    std::vector<size_t> batch;
+    {
+        std::lock_guard lock(scan_mutex);
+        batch.swap(ready);
+    }
+    for (size_t i : batch) {
+        for (auto name : dirs[i].names) {
+            trie.insert(name);
+        }
+    }
+    merged_dirs += batch.size();
+
+    if (!complete()) return false;
+    if (snapshot_stale) {
+        write_snapshot();
+        snapshot_stale = false;
+    }
+    return true;
+}
+
+void PathIndex::finish(Trie& trie) {
+    wait_for_scans();
+    merge(trie);
+}
+
+bool PathIndex::wait(std::chrono::milliseconds limit, const std::function<bool()>& cancelled) {
+    auto deadline = std::chrono::steady_clock::now() + limit;
+    std::unique_lock lock(scan_mutex);
+    while (scans_running > 0) {
+        if (cancelled && cancelled()) return false;
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) return false;
+        scan_done.wait_for(lock, std::min<std::chrono::steady_clock::duration>(CANCEL_POLL, deadline - now));
+    }
+    return true;
+}
@@ -0,0 +1,92 @@
+#ifndef SHELL_STARTER_CPP_PATHINDEX_H
+#define SHELL_STARTER_CPP_PATHINDEX_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ThreadPool.hpp"
+#include "Trie.hpp"
+
+// Executables of every PATH directory, persisted as an mmap'd snapshot.
+// A directory is only rescanned when its inode or mtime no longer matches.
+// Rescans can run on a thread pool, one task per directory into the directory's own buffer; the results are added
+// to the trie by whoever owns it, as they come in.
+class PathIndex {
+public:
+    struct Dir {
+        std::string path;
+        uint64_t dev = 0;
+        uint64_t ino = 0;
+        int64_t mtime_ns = 0;
+        std::vector<std::string_view> names; // point into the mapping or into storage
+        std::vector<char> storage;           // backing for rescanned directories
+    };
+
+    PathIndex() = default;
+    ~PathIndex();
+    PathIndex(const PathIndex&) = delete;
+    PathIndex& operator=(const PathIndex&) = delete;
+
+    // fill trie with all executables of $PATH, writes the snapshot back if something changed
+    void load(Trie& trie);
+
+    // load in the background: stale directories are scanned on pool, merge() adds what is ready
+    void start(ThreadPool& pool);
+    // adds the directories finished so far to trie, true once every one of them is in
+    bool merge(Trie& trie);
+    // waits for the scans still running, then merges
+    void finish(Trie& trie);
+    // waits up to limit for the scans still running without touching any trie, true once none is left.
+    // Gives up early, false, as soon as cancelled() says so.
+    bool wait(std::chrono::milliseconds limit, const std::function<bool()>& cancelled = {});
+    bool complete() const { return merged_dirs == dirs.size(); }
+    // eventfd, readable when merge() has something to add (-1 before the first start)
+    int ready_fd() const { return event_fd; }
+
+    // paths are known as soon as start() returns, names only once the directory is merged
+    const std::vector<Dir>& directories() const { return dirs; }
+    size_t rescanned() const { return rescanned_dirs; }
+
+    // $XDG_CACHE_HOME/shellcpp/path-index or ~/.cache/shellcpp/path-index
+    static std::filesystem::path default_snapshot_path();
+
+private:
+    std::vector<Dir> dirs;
+    std::filesystem::path snapshot_path;
+    const char* map_base = nullptr;
+    size_t map_size = 0;
+    size_t rescanned_dirs = 0;
+    bool snapshot_stale = false;
+
+    // shared with the scan tasks
+    std::mutex scan_mutex;
+    std::condition_variable scan_done;
+    size_t scans_running = 0;
+    std::vector<size_t> ready; // finished, not merged yet
+    size_t merged_dirs = 0;
+    int event_fd = -1;
+    static constexpr std::chrono::milliseconds CANCEL_POLL{5}; // how often wait() asks cancelled()
+
+    // pool nullptr: scan on this thread
+    void begin(ThreadPool* pool);
+    void finished(size_t dir);
+    void wait_for_scans();
+
+    void map_snapshot();
+    void unmap_snapshot();
+    // directories stored in the snapshot, names point into the mapping
+    std::vector<Dir> read_snapshot() const;
+    bool write_snapshot() const;
+
+    static void scan_directory(Dir& dir);
+};
+
+
+#endif //SHELL_STARTER_CPP_PATHINDEX_H
@@ -0,0 +1,96 @@
+#include "PathWatcher.hpp"
+
+#include <cerrno>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// PATH directories watched with inotify, events coalesced per name
+
+namespace {
+    constexpr uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_CLOSE_WRITE |
+                                    IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+}
+
+PathWatcher::~PathWatcher() {
+    if (inotify_fd >= 0) close(inotify_fd);
+}
+
+bool PathWatcher::watch(const std::vector<std::string>& watched) {
+    dirs = watched;
+    touched.clear();
+    rescan = false;
+
+    // the fd stays the same so whoever polls it keeps working, only the watches are replaced
+    if (inotify_fd < 0) inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) return false;
+    for (const auto& [wd, dir] : dir_of_watch) inotify_rm_watch(inotify_fd, wd);
+    dir_of_watch.clear();
+
+    for (size_t i = 0; i < dirs.size(); ++i) {
+        // a directory that can't be watched (limit reached, permissions) only misses live updates
+        int wd = inotify_add_watch(inotify_fd, dirs[i].c_str(), WATCH_MASK);
+        if (wd >= 0) dir_of_watch[wd] = i;
+    }
+    return !dir_of_watch.empty();
+}
+
+void PathWatcher::drain() {
+    if (inotify_fd < 0) return;
+
+    alignas(inotify_event) char buf[64 << 10];
+    while (true) {
+        ssize_t n = read(inotify_fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+
+        for (ssize_t at = 0; at < n;) {
+            auto* event = reinterpret_cast<inotify_event*>(buf + at);
+            at += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                rescan = true;
+                continue;
+            }
+            // late events of watches that were replaced
+            if (!dir_of_watch.contains(event->wd)) continue;
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                rescan = true;
+                continue;
+            }
+            if ((event->mask & IN_ISDIR) || event->len == 0) continue;
+            touched.emplace(event->name);
+        }
+    }
+}
+
+PathWatcher::Batch PathWatcher::take() {
+    Batch batch;
+    batch.rescan = rescan;
+    rescan = false;
+    if (batch.rescan) {
+        touched.clear();
+        return batch;
+    }
+
+    batch.changes.reserve(touched.size());
+    for (const auto& name : touched) {
+        // several events for one name (create, write, chmod, rename) end up as one check of how it is now
+        bool present = false;
+        for (const auto& dir : dirs) {
+            if (executable_in(dir, name)) {
+                present = true;
+                break;
+            }
+        }
+        batch.changes.push_back({name, present});
+    }
+    touched.clear();
+    return batch;
+}
+
+bool PathWatcher::executable_in(const std::string& dir, const std::string& name) {
+    std::string path = dir + "/" + name;
+    struct stat st{};
+    return stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode) && (st.st_mode & S_IXUSR);
+}
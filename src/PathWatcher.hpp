@@ -0,0 +1,52 @@
+#ifndef SHELL_STARTER_CPP_PATHWATCHER_H
+#define SHELL_STARTER_CPP_PATHWATCHER_H
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// inotify watch over the PATH directories, so commands installed or removed during a session show up in completion.
+// Reading events only records which names were touched; what they are now is checked once per batch, when the
+// shell asks for it, so a package manager writing thousands of files costs the line editor a few reads.
+class PathWatcher {
+public:
+    struct Change {
+        std::string name;
+        bool present; // an executable of that name is in one of the directories now
+    };
+
+    struct Batch {
+        bool rescan = false; // events were lost or a directory went away, the index has to be rebuilt
+        std::vector<Change> changes;
+    };
+
+    PathWatcher() = default;
+    ~PathWatcher();
+    PathWatcher(const PathWatcher&) = delete;
+    PathWatcher& operator=(const PathWatcher&) = delete;
+
+    // watches dirs (in PATH order) instead of the previous ones, false when none of them could be watched
+    bool watch(const std::vector<std::string>& dirs);
+    // readable when events are queued, -1 when inotify isn't available
+    int fd() const { return inotify_fd; }
+
+    // reads the queued events without blocking
+    void drain();
+    bool pending() const { return rescan || !touched.empty(); }
+    // everything since the last call
+    Batch take();
+
+private:
+    int inotify_fd = -1;
+    std::vector<std::string> dirs;
+    std::unordered_map<int, size_t> dir_of_watch; // watch descriptor -> dirs index
+    std::unordered_set<std::string> touched;
+    bool rescan = false;
+
+    // same test as the PATH scan: regular file (after symlinks) with the owner's x bit
+    static bool executable_in(const std::string& dir, const std::string& name);
+};
+
+
+#endif //SHELL_STARTER_CPP_PATHWATCHER_H
@@ -0,0 +1,160 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <unistd.h>
+
+// Profiler, everything is measured on the monotonic clock relative to the shell's start
+
+namespace {
+    std::string json_string(std::string_view text) {
+        std::string out = "\"";
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            } else {
+                out += c;
+            }
+        }
+        out += '"';
+        return out;
+    }
+
+    uint64_t timeval_us(const timeval& tv) {
+        return static_cast<uint64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+    }
+
+    double ms(uint64_t ns) {
+        return ns / 1e6;
+    }
+}
+
+Profiler::Profiler() : origin_ns(now_ns()) {}
+
+uint64_t Profiler::now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+const char* Profiler::phase_name(Phase phase) {
+    static const char* names[] = {"parse", "resolve", "spawn", "wait", "builtin"};
+    return names[phase];
+}
+
+void Profiler::set_trace(std::string path) {
+    trace_file = std::move(path);
+    tracing = !trace_file.empty();
+}
+
+void Profiler::disable() {
+    summary = false;
+    tracing = false;
+    trace_file.clear();
+    in_command = false;
+}
+
+void Profiler::add_span(Phase phase, std::string_view name, uint64_t start, uint64_t end) {
+    // only the outermost span counts towards the phase totals, a command's phases then add up to at most its wall.
+    // Outside a command (parsing the line) the time goes to the next command.
+    if (depth == 1) (in_command ? current.phase_ns : pending_ns)[phase] += end - start;
+    if (!tracing) return;
+
+    std::string label = phase_name(phase);
+    if (!name.empty()) {
+        label += ' ';
+        label += name;
+    }
+    events.push_back({std::move(label), phase_name(phase), start, end - start, {}});
+}
+
+void Profiler::begin_command(std::string_view text) {
+    if (!enabled()) return;
+    current = Command{};
+    current.text = text;
+    current.start_ns = now_ns();
+    std::copy(std::begin(pending_ns), std::end(pending_ns), current.phase_ns);
+    std::fill(std::begin(pending_ns), std::end(pending_ns), 0);
+    in_command = true;
+}
+
+void Profiler::discard_command() {
+    events.resize(command_first_event);
+    std::fill(std::begin(pending_ns), std::end(pending_ns), 0);
+    in_command = false;
+}
+
+void Profiler::add_child(const struct rusage& usage) {
+    if (!in_command) return;
+    current.children++;
+    current.child_user_us += timeval_us(usage.ru_utime);
+    current.child_sys_us += timeval_us(usage.ru_stime);
+    current.child_maxrss_kb = std::max(current.child_maxrss_kb, usage.ru_maxrss);
+}
+
+void Profiler::end_command(int status, std::ostream& out) {
+    if (!in_command) return;
+    in_command = false;
+    current.wall_ns = now_ns() - current.start_ns;
+    current.status = status;
+
+    total.wall_ns += current.wall_ns;
+    for (int p = 0; p < PhaseCount; ++p) total.phase_ns[p] += current.phase_ns[p];
+    total.children += current.children;
+    total.child_user_us += current.child_user_us;
+    total.child_sys_us += current.child_sys_us;
+    total.child_maxrss_kb = std::max(total.child_maxrss_kb, current.child_maxrss_kb);
+    command_count++;
+
+    if (tracing) {
+        char args[256];
+        std::snprintf(args, sizeof(args),
+                      "\"status\": %d, \"children\": %zu, \"child_user_ms\": %.3f, \"child_sys_ms\": %.3f, "
+                      "\"child_maxrss_kb\": %ld",
+                      status, current.children, current.child_user_us / 1e3, current.child_sys_us / 1e3,
+                      current.child_maxrss_kb);
+        std::string_view first_line = std::string_view(current.text).substr(0, current.text.find('\n'));
+        events.push_back({std::string(first_line), "command", current.start_ns, current.wall_ns, args});
+    }
+    command_first_event = events.size();
+
+    if (!summary) return;
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3) << "profile: " << ms(current.wall_ns) << " ms wall |";
+    for (int p = 0; p < PhaseCount; ++p) {
+        if (current.phase_ns[p]) out << ' ' << phase_name(static_cast<Phase>(p)) << ' ' << ms(current.phase_ns[p]);
+    }
+    if (current.children) {
+        out << " | " << current.children << (current.children == 1 ? " child" : " children") << " user "
+            << current.child_user_us / 1e3 << " sys " << current.child_sys_us / 1e3 << " maxrss "
+            << current.child_maxrss_kb << " KiB";
+    }
+    out << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+}
+
+bool Profiler::write_trace(const std::string& path) const {
+    std::FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+
+    long pid = getpid();
+    std::fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    std::fprintf(f, "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %ld, \"tid\": %ld, "
+                    "\"args\": {\"name\": \"shell\"}}", pid, pid);
+    for (const auto& e : events) {
+        std::fprintf(f, ",\n  {\"name\": %s, \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, "
+                        "\"pid\": %ld, \"tid\": %ld, \"args\": {%s}}",
+                     json_string(e.name).c_str(), e.category, (e.start_ns - origin_ns) / 1e3, e.duration_ns / 1e3,
+                     pid, pid, e.args.c_str());
+    }
+    std::fprintf(f, "\n]}\n");
+    return std::fclose(f) == 0;
+}
@@ -0,0 +1,112 @@
+#ifndef SHELL_STARTER_CPP_PROFILER_H
+#define SHELL_STARTER_CPP_PROFILER_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <sys/resource.h>
+#include <vector>
+
+// Per-command execution profile: wall time, time spent in each phase (parse, PATH resolution, spawn, wait,
+// builtins) and the rusage of the children that were waited for.
+// Off by default; while off a Span is a single branch and nothing is recorded.
+// With a trace file, every command and phase is also kept as an event for a Chrome trace (chrome://tracing, Perfetto).
+// A command is one element of a list: `a; b && c` is two, each with its own summary line.
+class Profiler {
+public:
+    enum Phase { Parse, Resolve, Spawn, Wait, Builtin, PhaseCount };
+
+    struct Command {
+        std::string text;
+        uint64_t start_ns = 0;
+        uint64_t wall_ns = 0;
+        uint64_t phase_ns[PhaseCount] = {};
+        size_t children = 0;
+        uint64_t child_user_us = 0;
+        uint64_t child_sys_us = 0;
+        long child_maxrss_kb = 0;
+        int status = 0;
+    };
+
+    // times one phase from construction to destruction, inline so that profiling off costs one branch
+    class Span {
+    public:
+        Span(Profiler& p, Phase phase, std::string_view name = {}) : phase(phase), name(name) {
+            if (!p.enabled()) return;
+            profiler = &p;
+            profiler->depth++;
+            start = now_ns();
+        }
+        ~Span() {
+            if (!profiler) return;
+            profiler->add_span(phase, name, start, now_ns());
+            profiler->depth--;
+        }
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+    private:
+        Profiler* profiler = nullptr; // nullptr: profiling was off
+        Phase phase;
+        std::string_view name;
+        uint64_t start = 0;
+    };
+
+    Profiler();
+
+    bool enabled() const { return summary || tracing; }
+    // set -o profile: a summary line after each command
+    void set_summary(bool on) { summary = on; }
+    bool summary_enabled() const { return summary; }
+    // profile the whole session, the shell writes the trace to path when it ends
+    void set_trace(std::string path);
+    const std::string& trace_path() const { return trace_file; }
+    // forked subshells neither report nor trace
+    void disable();
+
+    void begin_command(std::string_view text);
+    // the input didn't run (more input needed), forget what parsing it cost
+    void discard_command();
+    // closes the command, prints the summary line to out when set -o profile is on
+    void end_command(int status, std::ostream& out);
+
+    void add_child(const struct rusage& usage);
+
+    // totals over every command of the session
+    const Command& totals() const { return total; }
+    size_t commands() const { return command_count; }
+    static const char* phase_name(Phase phase);
+
+    // Chrome trace event format, false when path can't be written
+    bool write_trace(const std::string& path) const;
+
+private:
+    struct Event {
+        std::string name;
+        const char* category;
+        uint64_t start_ns;
+        uint64_t duration_ns;
+        std::string args; // JSON object body, may be empty
+    };
+
+    bool summary = false;
+    bool tracing = false;
+    std::string trace_file;
+    uint64_t origin_ns;
+
+    bool in_command = false;
+    int depth = 0; // nested spans of the same phase only count once
+    Command current;
+    uint64_t pending_ns[PhaseCount] = {}; // spent outside a command, charged to the next one
+    Command total;
+    size_t command_count = 0;
+    std::vector<Event> events;
+    size_t command_first_event = 0; // events after it belong to the input not run yet
+
+    static uint64_t now_ns();
+    void add_span(Phase phase, std::string_view name, uint64_t start, uint64_t end);
+};
+
+
+#endif //SHELL_STARTER_CPP_PROFILER_H
@@ -0,0 +1,156 @@
+#include "Redirect.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Redirection engine, nothing here touches the shell's own fds except apply()
+
+Redirections::~Redirections() {
+    for (int fd : opened) close(fd);
+}
+
+namespace {
+    // above the fds a redirection can name, so no dup2 of the list lands on a file opened for another one
+    int keep_high(int fd) {
+        if (fd < 0 || fd >= 10) return fd;
+        int high = fcntl(fd, F_DUPFD_CLOEXEC, 10);
+        close(fd);
+        return high;
+    }
+}
+
+int Redirections::open_file(const ast::Redirect& r, int flags) {
+    std::string path(r.target.text);
+    int fd = keep_high(open(path.c_str(), flags | O_CLOEXEC, 0644));
+    if (fd < 0) {
+        std::cerr << "shell: " << path << ": " << std::strerror(errno) << std::endl;
+        return -1;
+    }
+    opened.push_back(fd);
+    return fd;
+}
+
+int Redirections::open_memfd(std::string_view body, bool add_newline) {
+    int fd = keep_high(memfd_create("shell-heredoc", MFD_CLOEXEC));
+    if (fd < 0) {
+        std::cerr << "shell: here-document: " << std::strerror(errno) << std::endl;
+        return -1;
+    }
+    opened.push_back(fd);
+
+    auto write_all = [fd](std::string_view data) {
+        while (!data.empty()) {
+            ssize_t n = write(fd, data.data(), data.size());
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            data.remove_prefix(n);
+        }
+        return true;
+    };
+
+    if (!write_all(body) || (add_newline && !write_all("\n")) || lseek(fd, 0, SEEK_SET) < 0) {
+        std::cerr << "shell: here-document: " << std::strerror(errno) << std::endl;
+        return -1;
+    }
+    return fd;
+}
+
+bool Redirections::prepare(const std::pmr::vector<ast::Redirect>& redirects) {
+    for (const auto& r : redirects) {
+        int fd = -1;
+        switch (r.kind) {
+            case ast::Redirect::In:
+                fd = open_file(r, O_RDONLY);
+                break;
+            case ast::Redirect::Out:
+                fd = open_file(r, O_WRONLY | O_CREAT | O_TRUNC);
+                break;
+            case ast::Redirect::Append:
+                fd = open_file(r, O_WRONLY | O_CREAT | O_APPEND);
+                break;
+            case ast::Redirect::OutErr:
+            case ast::Redirect::AppendErr:
+                fd = open_file(r, O_WRONLY | O_CREAT | (r.kind == ast::Redirect::OutErr ? O_TRUNC : O_APPEND));
+                if (fd < 0) return false;
+                ops.push_back(FdAction::dup2(fd, STDOUT_FILENO));
+                ops.push_back(FdAction::dup2(fd, STDERR_FILENO));
+                continue;
+            case ast::Redirect::HereDoc:
+                fd = open_memfd(r.target.text, false);
+                break;
+            case ast::Redirect::HereString:
+                fd = open_memfd(r.target.text, true);
+                break;
+            case ast::Redirect::Dup: {
+                if (r.target.text == "-") {
+                    ops.push_back(FdAction::close(r.fd));
+                    continue;
+                }
+                std::string target(r.target.text);
+                char* end = nullptr;
+                long src = std::strtol(target.c_str(), &end, 10);
+                if (target.empty() || *end != '\0' || src < 0) {
+                    std::cerr << "shell: " << target << ": ambiguous redirect" << std::endl;
+                    return false;
+                }
+                // the copy is made at this point of the list, not from the original fd
+                ops.push_back(FdAction::dup2(static_cast<int>(src), r.fd));
+                continue;
+            }
+        }
+        if (fd < 0) return false;
+        ops.push_back(FdAction::dup2(fd, r.fd));
+    }
+    return true;
+}
+
+void Redirections::apply(std::vector<std::pair<int, int>>* saved) const {
+    for (const auto& op : ops) {
+        if (saved && std::none_of(saved->begin(), saved->end(), [&op](auto& s) { return s.first == op.fd; })) {
+            saved->emplace_back(op.fd, fcntl(op.fd, F_DUPFD_CLOEXEC, 10));
+        }
+        if (op.kind == FdAction::Close) {
+            close(op.fd);
+        } else if (op.src != op.fd) {
+            dup2(op.src, op.fd);
+        }
+    }
+}
+
+void Redirections::restore(std::vector<std::pair<int, int>>& saved) {
+    for (auto it = saved.rbegin(); it != saved.rend(); ++it) {
+        auto [fd, copy] = *it;
+        if (copy >= 0) {
+            dup2(copy, fd);
+            close(copy);
+        } else {
+            close(fd); // wasn't open before
+        }
+    }
+    saved.clear();
+}
+
+int Redirections::resolve(int fd) const {
+    // replay the operations on a small fd -> shell fd table
+    std::vector<std::pair<int, int>> table;
+    auto lookup = [&table](int f) {
+        for (const auto& [from, to] : table) {
+            if (from == f) return to;
+        }
+        return f;
+    };
+
+    for (const auto& op : ops) {
+        int target = op.kind == FdAction::Close ? -1 : lookup(op.src);
+        auto it = std::find_if(table.begin(), table.end(), [&op](auto& e) { return e.first == op.fd; });
+        if (it != table.end()) it->second = target;
+        else table.emplace_back(op.fd, target);
+    }
+    return lookup(fd);
+}
@@ -0,0 +1,44 @@
+#ifndef SHELL_STARTER_CPP_REDIRECT_H
+#define SHELL_STARTER_CPP_REDIRECT_H
+
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+#include "Parser.hpp"
+#include "Spawn.hpp"
+
+// The redirections of one command as an ordered list of fd operations.
+// Files and here-doc memfds are opened by the shell (close-on-exec), the operations are then either
+// handed to posix_spawn as file actions, performed in a forked child, or resolved for builtins running in the shell.
+class Redirections {
+public:
+    Redirections() = default;
+    ~Redirections();
+    Redirections(const Redirections&) = delete;
+    Redirections& operator=(const Redirections&) = delete;
+
+    // opens what the redirections need, false after printing why one couldn't be
+    bool prepare(const std::pmr::vector<ast::Redirect>& redirects);
+
+    // dup2 / close operations in the order they were written, for posix_spawn
+    const std::vector<FdAction>& actions() const { return ops; }
+
+    // performs the operations on this process's fds, saved (if given) gets what undoes them
+    void apply(std::vector<std::pair<int, int>>* saved = nullptr) const;
+    static void restore(std::vector<std::pair<int, int>>& saved);
+
+    // the shell's fd that fd refers to once the operations are done, -1 when it ends up closed
+    int resolve(int fd) const;
+
+private:
+    std::vector<FdAction> ops;
+    std::vector<int> opened;
+
+    int open_file(const ast::Redirect& r, int flags);
+    // body written to an anonymous memory file, read back from the start by the command
+    int open_memfd(std::string_view body, bool add_newline);
+};
+
+
+#endif //SHELL_STARTER_CPP_REDIRECT_H
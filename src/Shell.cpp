@@ -0,0 +1,1765 @@
+#include "Shell.hpp"
+#include "FdStream.hpp"
+#include "Spawn.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <span>
+#include <sstream>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+
+// Builtins, execution of parsed input, job control, line editing, history and completion
+
+Shell::Shell(bool interactive) : curDir(std::filesystem::current_path()), running(true), interactive(interactive) {
+  // built ins
+  commands["exit"] = [this](auto args){handle_exit(args);};
+  commands["pwd"] = [this](auto) {std::cout << curDir.string() << std::endl;};
+  commands["echo"] = [this](auto args) { handle_echo(args); };
+  commands["cd"] = [this](auto args) { handle_cd(args); };
+  commands["type"] = [this](auto args) { handle_type(args); };
+  commands["history"] = [this](auto args) {handle_history(args); };
+  commands["hash"] = [this](auto args) { handle_hash(args); };
+  commands["jobs"] = [this](auto args) { handle_jobs(args); };
+  commands["fg"] = [this](auto args) { handle_fg(args); };
+  commands["bg"] = [this](auto args) { handle_bg(args); };
+  commands["wait"] = [this](auto args) { handle_wait(args); };
+  commands["command"] = [this](auto args) { handle_command(args); };
+  commands["set"] = [this](auto args) { handle_set(args); };
+  commands["times"] = [this](auto args) { handle_times(args); };
+  commands["export"] = [this](auto args) { handle_export(args); };
+  commands["unset"] = [this](auto args) { handle_unset(args); };
+
+  // $NAME: the environment is where variables start out
+  variables.import_environment(environ);
+
+  // cat / head / tail / wc / tee move the data themselves, `command cat` still runs the real one
+  for (const auto& name : fastio::names()) {
+    fastio::Builtin builtin = fastio::find(name);
+    commands[name] = [this, builtin](auto args) { run_fast(builtin, args); };
+    builtins.insert(name);
+  }
+
+  // a reader that went away is a write error (EPIPE) for builtins, not the end of the shell
+  signal(SIGPIPE, SIG_IGN);
+
+  // SHELLCPP_TRACE=file: the whole session as a Chrome trace, written when the shell ends
+  if (const char* trace = std::getenv("SHELLCPP_TRACE"); trace && *trace) profiler.set_trace(trace);
+
+  // scripts never complete or recall anything, skip the PATH scan and HISTFILE
+  if (!interactive) return;
+
+  init_job_control();
+
+  editor.on_tab = [this](LineEditor& ed, int tabs) { complete(ed, tabs); };
+  editor.on_key = [this]() { cancel_completion(); };
+  if (completion_worker.fd() >= 0) {
+    editor.watch(completion_worker.fd(), [this]() { on_completion(); });
+  }
+  editor.history_size = [this]() { return history.size(); };
+  editor.history_entry = [this](size_t i) { return history[i]; };
+  editor.history_search = [this](std::string_view query, size_t before) {
+    return history_index.search(history, query, before);
+  };
+
+  // add the commands to the Trie
+  add_command_to_Trie(command_trie);
+  if (path_index.ready_fd() >= 0) {
+    editor.watch(path_index.ready_fd(), [this]() {
+      // a completion walk has the index: the fd stays readable, the next wakeup merges
+      std::unique_lock lock(index_mutex, std::try_to_lock);
+      if (lock.owns_lock()) path_index.merge(command_trie);
+    });
+  }
+
+  // commands installed or removed later: events are only read while typing, applied when the index is used
+  watch_path();
+  if (path_watcher.fd() >= 0) {
+    editor.watch(path_watcher.fd(), [this]() { path_watcher.drain(); });
+  }
+
+  // mapped, not read: lines are only looked at when history needs them
+  const char* env_hist = std::getenv("HISTFILE");
+  if (env_hist && !history.open_histfile(env_hist)) {
+    history_error(env_hist);
+  }
+  // completion ranking, next to HISTFILE
+  if (env_hist) {
+    frecency_path = std::string(env_hist) + ".frecency";
+    frecency.load(frecency_path);
+  }
+}
+
+Shell::~Shell() {
+  if (!profiler.trace_path().empty() && !profiler.write_trace(profiler.trace_path())) {
+    std::cerr << "shell: " << profiler.trace_path() << ": " << std::strerror(errno) << std::endl;
+  }
+}
+
+void Shell::run() {
+  while (running) {
+    // jobs that finished while a foreground command ran
+    report_jobs();
+    // commands other sessions sharing HISTFILE ran meanwhile
+    history.refresh();
+
+    std::string input;
+    if (!editor.read_line("$ ", input)) {
+      // EOF (Ctrl-D on an empty line) behaves like exit
+      handle_exit();
+      break;
+    }
+
+    if (input.empty()) continue;
+
+    add_history(input);
+
+    // an open quote, a trailing | or && ... : keep reading lines
+    while (!execute_line(input, true)) {
+      std::string more;
+      if (!editor.read_line("> ", more)) {
+        execute_line(input); // reports the unexpected end
+        break;
+      }
+      if (editor.was_cancelled()) break;
+      if (!more.empty()) add_history(more);
+      input += '\n';
+      input += more;
+    }
+    std::cout.flush();
+  }
+}
+
+void Shell::run_script(int fd) {
+  std::vector<char> buf(64 * 1024);
+  std::string pending; // line split across two reads, or lines of a command that isn't complete yet
+  std::string waiting_for; // here-doc delimiter the pending command needs before it can be complete
+
+  while (running) {
+    ssize_t n = read(fd, buf.data(), buf.size());
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+
+    const char* p = buf.data();
+    const char* end = p + n;
+    while (running && p < end) {
+      const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+      if (!nl) {
+        pending.append(p, end);
+        break;
+      }
+      size_t line_start = pending.size();
+      pending.append(p, nl);
+      // one line at a time: a complete command runs before the next line is read. Inside a here-doc body only
+      // its delimiter line can change that, the others aren't parsed again
+      bool skip = !waiting_for.empty() && !delimiter_line(std::string_view(pending).substr(line_start), waiting_for);
+      if (skip || !execute_line(pending, true, &waiting_for)) pending += '\n';
+      else pending.clear();
+      p = nl + 1;
+    }
+  }
+
+  if (running && !pending.empty()) {
+    execute_line(pending);
+  }
+}
+
+void Shell::run_string(const std::string& script) {
+  size_t start = 0;
+  size_t from = 0; // start of a command that spans several lines
+  std::string waiting_for; // as in run_script
+  while (running && start <= script.size()) {
+    size_t nl = script.find('\n', start);
+    if (nl == std::string::npos) nl = script.size();
+    bool last = nl == script.size();
+    std::string_view line = std::string_view(script).substr(start, nl - start);
+    if (last || waiting_for.empty() || delimiter_line(line, waiting_for)) {
+      if (execute_line(std::string_view(script).substr(from, nl - from), !last, &waiting_for)) from = nl + 1;
+    }
+    start = nl + 1;
+  }
+}
+
+void Shell::wait_for_index() {
+  std::lock_guard lock(index_mutex);
+  path_index.finish(command_trie);
+}
+
+bool Shell::delimiter_line(std::string_view line, std::string_view delimiter) {
+  if (line.ends_with('\r')) line.remove_suffix(1);
+  size_t tabs = line.find_first_not_of('\t');
+  return line.substr(tabs == std::string_view::npos ? line.size() : tabs) == delimiter;
+}
+
+Shell::CompletionWord Shell::completion_word(std::string_view line) {
+  CompletionWord word;
+  bool in_word = false;
+  bool escaped = false;
+  bool after_redirect = false; // the next word is a file name, not a command
+  for (size_t i = 0; i < line.size(); ++i) {
+    char c = line[i];
+    if (escaped) {
+      word.text += c;
+      escaped = false;
+      continue;
+    }
+    if (word.quote) {
+      if (c == word.quote) word.quote = 0;
+      else if (c == '\\' && word.quote == '"') escaped = true;
+      else word.text += c;
+      continue;
+    }
+    if (c == ' ' || c == '\t' || c == '\n' || std::strchr("|&;()<>", c)) {
+      if (in_word) {
+        // a finished word: the command's name or an argument, anything after it is an argument
+        if (!after_redirect && word.text != "{") {
+          if (word.command) word.command_name = word.text;
+          word.command = false;
+        }
+        after_redirect = false;
+        in_word = false;
+        word.text.clear();
+      }
+      if (c == '<' || c == '>') after_redirect = true;
+      else if (c != ' ' && c != '\t') word.command = true, after_redirect = false, word.command_name.clear();
+      word.start = i + 1;
+      continue;
+    }
+    in_word = true;
+    if (c == '\\') escaped = true;
+    else if (c == '\'' || c == '"') word.quote = c;
+    else word.text += c;
+  }
+  if (after_redirect) word.command = false;
+  return word;
+}
+
+std::string Shell::escape_for(std::string_view text, char quote) {
+  std::string out;
+  for (char c : text) {
+    if (quote == '"' ? (c == '"' || c == '\\' || c == '$' || c == '`') : !quote && std::strchr(" \t\\'\"|&;()<>$`*?[]#!{}~", c)) out += '\\';
+    out += c;
+  }
+  return out;
+}
+
+void Shell::complete(LineEditor& editor, int tabs) {
+  if (completion.request) {
+    // still walking for this very line: only remember that the list was asked for
+    completion.tabs = tabs;
+    return;
+  }
+  sync_path();
+
+  PendingCompletion job;
+  job.word = completion_word(std::string_view(editor.buffer()).substr(0, editor.cursor()));
+  job.tabs = tabs;
+
+  CompletionWorker::Walk walk;
+  if (options["fuzzy"] && job.word.command && !job.word.text.empty() && job.word.text.find('/') == std::string::npos) {
+    job.fuzzy = true;
+    walk = [this, pattern = job.word.text](const CompletionWorker::Emit& emit) {
+      // stale PATH directories get a moment to finish, waited for outside the index lock so keys are still read
+      path_index.wait(PATH_SCAN_WAIT, [this]() { return completion_worker.cancelled(); });
+      std::lock_guard lock(index_mutex);
+      bool whole = path_index.merge(command_trie);
+      if (fuzzy_index.source != command_trie.generation()) {
+        fuzzy_index.clear();
+        command_trie.for_each_completion("", [this](std::string_view name) {
+          fuzzy_index.add(name);
+          return true;
+        });
+        fuzzy_index.source = command_trie.generation();
+      }
+      for (const auto& hit : fuzzy_index.best(pattern, FUZZY_LIMIT)) {
+        if (!emit(hit.name, false)) break;
+      }
+      return whole;
+    };
+  } else if (job.word.command && job.word.text.find('/') == std::string::npos) {
+    job.base = job.word.text;
+    walk = [this, prefix = job.base](const CompletionWorker::Emit& emit) {
+      // only command names need the PATH scan, same short wait as above
+      path_index.wait(PATH_SCAN_WAIT, [this]() { return completion_worker.cancelled(); });
+      std::lock_guard lock(index_mutex);
+      bool whole = path_index.merge(command_trie);
+      command_trie.for_each_completion(prefix, [&emit](std::string_view name) { return emit(name, false); });
+      return whole;
+    };
+  } else {
+    job.path = true;
+    size_t slash = job.word.text.rfind('/');
+    std::string dir_part = slash == std::string::npos ? "" : job.word.text.substr(0, slash + 1);
+    job.base = job.word.text.substr(dir_part.size());
+
+    std::string dir = dir_part.empty() ? "." : dir_part;
+    if (dir.starts_with("~") && (dir.size() == 1 || dir[1] == '/')) {
+      const std::string* home = variables.get("HOME");
+      if (home) dir = *home + dir.substr(1);
+    }
+    walk = [this, dir, base = job.base](const CompletionWorker::Emit& emit) {
+      // dir_cache is the worker's alone, a slow directory never holds up the prompt
+      dir_cache.for_each(dir, base, [&emit](const DirCache::Match& m) { return emit(m.name, m.directory); });
+      return true;
+    };
+  }
+
+  job.request = completion_worker.start(std::move(walk));
+  completion = std::move(job);
+}
+
+void Shell::on_completion() {
+  CompletionWorker::Batch batch = completion_worker.take();
+  if (!completion.request || batch.request != completion.request) return;
+
+  completion.matches.insert(completion.matches.end(), std::make_move_iterator(batch.matches.begin()),
+                            std::make_move_iterator(batch.matches.end()));
+  if (!batch.done) return;
+
+  PendingCompletion job = std::move(completion);
+  completion = {};
+  const auto& matches = job.matches;
+
+  if (batch.partial) {
+    // some PATH directories are still being scanned: nothing is inserted from a list that may grow
+    editor.bell();
+    std::vector<std::string> lines = format_columns(matches);
+    lines.push_back("(PATH is still being scanned, Tab again for every match)");
+    editor.page(std::move(lines));
+    return;
+  }
+
+  if (job.fuzzy) {
+    // best first: one match replaces what was typed, several are listed in that order
+    if (matches.empty()) editor.bell();
+    else if (matches.size() == 1) editor.replace(job.word.start, matches[0].text + " ");
+    else if (job.tabs == 1) editor.bell();
+    else editor.page(format_columns(matches));
+    return;
+  }
+
+  // command names are inserted as they are, file names escaped for the lexer
+  auto quote = [&job](std::string_view text) { return job.path ? escape_for(text, job.word.quote) : std::string(text); };
+
+  if (matches.empty()) {
+    // bell if no match
+    editor.bell();
+  } else if (matches.size() == 1) {
+    // perfect autocomplete, a directory goes on with its entries
+    std::string rest = quote(std::string_view(matches[0].text).substr(job.base.size()));
+    if (matches[0].directory) rest += '/';
+    else rest += job.word.quote && job.path ? std::string{job.word.quote, ' '} : " ";
+    editor.insert(rest);
+  } else {
+    // matches come sorted: what the first and the last share, all of them share
+    const std::string& first = matches.front().text;
+    const std::string& last = matches.back().text;
+    size_t lcp = 0;
+    while (lcp < first.size() && lcp < last.size() && first[lcp] == last[lcp]) lcp++;
+
+    if (lcp > job.base.size()) {
+      editor.insert(quote(std::string_view(first).substr(job.base.size(), lcp - job.base.size())));
+      return;
+    }
+    if (job.tabs == 1) {
+      editor.bell();
+      return;
+    }
+
+    rank(job);
+    if (matches.size() > COMPLETION_QUERY_ITEMS) {
+      std::string question = "Display all " + std::to_string(matches.size()) + " possibilities? (y or n)";
+      editor.ask(question, [this, lines = format_columns(matches)](bool yes) mutable {
+        if (yes) editor.page(std::move(lines));
+      });
+    } else {
+      editor.page(format_columns(matches));
+    }
+  }
+}
+
+void Shell::cancel_completion() {
+  if (!completion.request) return;
+  completion_worker.cancel();
+  completion = {};
+}
+
+std::vector<std::string> Shell::format_columns(const std::vector<CompletionWorker::Match>& matches) {
+  size_t width = 0;
+  for (const auto& m : matches) width = std::max(width, m.text.size() + m.directory);
+  width += 2;
+
+  size_t cols = 80;
+  struct winsize ws{};
+  if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0) cols = ws.ws_col;
+  size_t per_row = std::max<size_t>(1, cols / width);
+  size_t rows = (matches.size() + per_row - 1) / per_row;
+
+  std::vector<std::string> lines(rows);
+  for (size_t r = 0; r < rows; ++r) {
+    for (size_t c = 0; c < per_row; ++c) {
+      size_t i = c * rows + r;
+      if (i >= matches.size()) break;
+      std::string& line = lines[r];
+      line.resize(c * width, ' ');
+      line += matches[i].text;
+      if (matches[i].directory) line += '/';
+    }
+  }
+  return lines;
+}
+
+bool Shell::execute_line(std::string_view input, bool more_input, std::string* waiting_for) {
+  // scripts have nobody to tell, just collect finished background jobs
+  if (!interactive && !jobs.empty()) {
+    jobs.reap();
+    jobs.take_notifications();
+  }
+
+  // the tree and the unquoted words of this input, released together at the end
+  std::array<std::byte, 4096> initial;
+  std::pmr::monotonic_buffer_resource arena(initial.data(), initial.size());
+
+  ast::List* list = nullptr;
+  Parser parser(input, &arena);
+  Parser::Status status;
+  {
+    Profiler::Span span(profiler, Profiler::Parse);
+    status = parser.parse(list);
+  }
+
+  if (waiting_for) *waiting_for = status == Parser::Incomplete ? parser.heredoc_delimiter() : "";
+  if (status == Parser::Incomplete && more_input) {
+    profiler.discard_command();
+    return false;
+  }
+  if (status != Parser::Ok) {
+    if (status == Parser::Incomplete) {
+      std::cerr << "shell: syntax error: unexpected end of file" << std::endl;
+    } else {
+      std::cerr << "shell: syntax error near unexpected token '" << parser.error_token() << "'" << std::endl;
+    }
+    last_status = 2;
+    profiler.begin_command(input);
+    profiler.end_command(last_status, std::cerr);
+    return true;
+  }
+
+  if (interactive) note_usage(*list);
+  // one profile per list element, so `set -o profile; cmd` already profiles cmd
+  for (const auto& item : list->items) {
+    if (!running) break;
+    profiler.begin_command(item.and_or->text);
+    if (item.background) run_background(*item.and_or, &arena);
+    else run_and_or(*item.and_or, &arena);
+    if (profiler.summary_enabled()) std::cout.flush(); // the summary comes after the command's output
+    profiler.end_command(last_status, std::cerr);
+  }
+  return true;
+}
+
+void Shell::rank(PendingCompletion& job) {
+  if (frecency.size() == 0) return;
+
+  std::string dir_part = job.word.text.substr(0, job.word.text.size() - job.base.size());
+  std::vector<std::pair<double, size_t>> order;
+  order.reserve(job.matches.size());
+  bool any = false;
+  for (size_t i = 0; i < job.matches.size(); ++i) {
+    const std::string& text = job.matches[i].text;
+    double score = job.path ? frecency.score(job.word.command_name, dir_part + text) : frecency.score(text);
+    any = any || score > 0;
+    order.emplace_back(-score, i);
+  }
+  if (!any) return;
+
+  std::stable_sort(order.begin(), order.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+  std::vector<CompletionWorker::Match> ranked;
+  ranked.reserve(job.matches.size());
+  for (const auto& [score, i] : order) ranked.push_back(std::move(job.matches[i]));
+  job.matches = std::move(ranked);
+}
+
+void Shell::note_usage(const ast::List& list) {
+  for (const auto& item : list.items) {
+    std::vector<const ast::Pipeline*> pipelines{item.and_or->first};
+    for (const auto& [op, pipeline] : item.and_or->rest) pipelines.push_back(pipeline);
+    for (const ast::Pipeline* pipeline : pipelines) {
+      for (const ast::Command* cmd : pipeline->commands) {
+        if (cmd->body) note_usage(*cmd->body);
+        if (cmd->words.empty()) continue;
+
+        std::string_view name = cmd->words[0].text;
+        frecency.use(name);
+        for (size_t i = 1; i < cmd->words.size(); ++i) {
+          std::string_view arg = cmd->words[i].text;
+          // options are never completed, a directory is completed without its '/'
+          if (arg.empty() || arg.starts_with('-')) continue;
+          if (arg.size() > 1 && arg.ends_with('/')) arg.remove_suffix(1);
+          frecency.use(name, arg);
+        }
+      }
+    }
+  }
+}
+
+void Shell::handle_exit(const std::vector<std::string>& arg_list) {
+  // exit n : status of the shell, otherwise the last command's
+  if (!arg_list.empty()) {
+    last_status = static_cast<int>(std::strtol(arg_list[0].c_str(), nullptr, 10)) & 0xFF;
+  }
+
+  // entries are recorded as they are entered, only the ones that failed are still missing
+  if (interactive && !history.histfile().empty() && !history.sync_histfile()) {
+    history_error(history.histfile());
+  }
+  if (interactive && !frecency_path.empty() && frecency.size() > 0) frecency.save(frecency_path);
+
+  running = false;
+}
+
+void Shell::add_command_to_Trie(Trie& command_trie) {
+
+  // add built-ins
+  for (const auto& command: builtins) {
+    command_trie.insert(command);
+  }
+
+  // add all the executables from PATH: unchanged directories come from the snapshot, changed ones are
+  // scanned on the pool and merged while the user types
+  path_index.start(pool);
+}
+
+void Shell::watch_path() {
+  std::vector<std::string> dirs;
+  for (const auto& dir : path_index.directories()) dirs.push_back(dir.path);
+  path_watcher.watch(dirs);
+}
+
+void Shell::sync_path() {
+  if (!path_watcher.pending() && !path_changed) return;
+
+  std::lock_guard lock(index_mutex);
+  PathWatcher::Batch batch = path_watcher.take();
+  if (batch.rescan || path_changed) {
+    // lost events, a directory gone or another PATH: unchanged directories still come from the snapshot
+    path_changed = false;
+    command_trie = Trie{};
+    add_command_to_Trie(command_trie);
+    command_hash.clear();
+    watch_path();
+    return;
+  }
+
+  for (const auto& change : batch.changes) {
+    if (change.present) command_trie.insert(change.name);
+    else if (!builtins.contains(change.name)) command_trie.remove(change.name);
+    // the hashed path may be gone or shadowed by the new one
+    command_hash.remove(change.name);
+  }
+}
+
+std::string Shell::find_in_path(const std::string& cmd, bool count_hit) {
+  sync_path();
+  Profiler::Span span(profiler, Profiler::Resolve, cmd);
+  return command_hash.lookup(cmd, count_hit);
+}
+
+void Shell::assign(std::string_view name, std::string value) {
+  variables.set(name, std::move(value));
+  variable_changed(name);
+}
+
+void Shell::variable_changed(std::string_view name) {
+  if (name == "PATH" && interactive) path_changed = true;
+}
+
+void Shell::handle_export(const std::vector<std::string>& arg_list) {
+  if (arg_list.empty() || (arg_list.size() == 1 && arg_list[0] == "-p")) {
+    for (const auto& [name, value] : variables.exported()) {
+      std::cout << "declare -x " << name << "=\"" << escape_for(value, '"') << "\"\n";
+    }
+    return;
+  }
+
+  for (const auto& arg : arg_list) {
+    size_t eq = arg.find('=');
+    std::string_view name = std::string_view(arg).substr(0, eq);
+    if (!Variables::valid_name(name)) {
+      std::cerr << "export: `" << arg << "': not a valid identifier" << std::endl;
+      last_status = 1;
+      continue;
+    }
+    if (eq == std::string::npos) {
+      variables.export_name(name);
+    } else {
+      std::string value = arg.substr(eq + 1);
+      variables.export_name(name, &value);
+    }
+    variable_changed(name);
+  }
+}
+
+void Shell::handle_unset(const std::vector<std::string>& arg_list) {
+  for (const auto& arg : arg_list) {
+    if (arg == "-v") continue;
+    if (!Variables::valid_name(arg)) {
+      std::cerr << "unset: `" << arg << "': not a valid identifier" << std::endl;
+      last_status = 1;
+      continue;
+    }
+    variables.unset(arg);
+    variable_changed(arg);
+  }
+}
+
+void Shell::handle_echo(const std::vector<std::string>& arg_list) {
+  for (size_t i = 0; i < arg_list.size(); ++i) {
+    std::cout << arg_list[i];
+    if (i < arg_list.size() -1) {
+       std::cout << " ";
+    }
+  }
+  std::cout << std::endl;
+}
+
+void Shell::handle_type(const std::vector<std::string>& arg_list) {
+  if (arg_list.empty()) return;
+  const std::string& cmd = arg_list[0];
+
+  if (builtins.contains(cmd)) {
+    std::cout << cmd << " is a shell builtin" << std::endl;
+  } else {
+    std::string path = find_in_path(cmd, false);
+    if (!path.empty()) {
+      std::cout << cmd << " is " << path << std::endl;
+    } else {
+      std::cerr << cmd << ": not found" << std::endl;
+      last_status = 1;
+    }
+  }
+}
+
+void Shell::handle_command(const std::vector<std::string>& arg_list) {
+  if (arg_list.empty()) return;
+
+  if (arg_list[0] == "-v") {
+    for (size_t i = 1; i < arg_list.size(); ++i) {
+      const std::string& name = arg_list[i];
+      std::string path = builtins.contains(name) ? name : find_in_path(name, false);
+      if (path.empty()) last_status = 1;
+      else std::cout << path << std::endl;
+    }
+    return;
+  }
+
+  auto it = commands.find(arg_list[0]);
+  if (it == commands.end() || fastio::find(arg_list[0])) {
+    std::cerr << "command: " << arg_list[0] << ": not a builtin here" << std::endl;
+    last_status = 1;
+    return;
+  }
+  it->second(std::vector<std::string>(arg_list.begin() + 1, arg_list.end()));
+}
+
+void Shell::handle_set(const std::vector<std::string>& arg_list) {
+  if (arg_list.empty() || (arg_list.size() == 1 && arg_list[0] == "-o")) {
+    for (const auto& [name, on] : options) {
+      std::cout << name << std::string(name.size() < 15 ? 15 - name.size() : 1, ' ') << '\t' << (on ? "on" : "off")
+                << '\n';
+    }
+    return;
+  }
+
+  for (size_t i = 0; i < arg_list.size(); i += 2) {
+    const std::string& flag = arg_list[i];
+    if ((flag != "-o" && flag != "+o") || i + 1 >= arg_list.size()) {
+      std::cerr << "set: " << flag << ": invalid option" << std::endl;
+      last_status = 2;
+      return;
+    }
+    auto it = options.find(arg_list[i + 1]);
+    if (it == options.end()) {
+      std::cerr << "set: " << arg_list[i + 1] << ": invalid option name" << std::endl;
+      last_status = 1;
+      return;
+    }
+    it->second = flag == "-o";
+  }
+  profiler.set_summary(options["profile"]);
+}
+
+void Shell::handle_times(const std::vector<std::string>& arg_list) {
+  auto format = [](const timeval& tv) {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%ldm%ld.%03lds", static_cast<long>(tv.tv_sec / 60),
+                  static_cast<long>(tv.tv_sec % 60), static_cast<long>(tv.tv_usec / 1000));
+    return std::string(buf);
+  };
+
+  if (arg_list.empty()) {
+    struct rusage self{}, children{};
+    getrusage(RUSAGE_SELF, &self);
+    getrusage(RUSAGE_CHILDREN, &children);
+    std::cout << format(self.ru_utime) << ' ' << format(self.ru_stime) << '\n'
+              << format(children.ru_utime) << ' ' << format(children.ru_stime) << std::endl;
+    return;
+  }
+
+  if (arg_list.size() == 2 && arg_list[0] == "-t") {
+    // events are only kept for a trace, set -o profile alone doesn't grow the shell
+    if (profiler.trace_path().empty()) {
+      std::cerr << "times: -t: no trace is being recorded (SHELLCPP_TRACE=file)" << std::endl;
+      last_status = 1;
+      return;
+    }
+    if (!profiler.write_trace(arg_list[1])) {
+      std::cerr << "times: " << arg_list[1] << ": " << std::strerror(errno) << std::endl;
+      last_status = 1;
+    }
+    return;
+  }
+
+  if (arg_list.size() != 1 || arg_list[0] != "-v") {
+    std::cerr << "times: usage: times [-v] [-t file]" << std::endl;
+    last_status = 2;
+    return;
+  }
+  if (profiler.commands() == 0) {
+    std::cout << "times: nothing profiled yet (set -o profile)" << std::endl;
+    return;
+  }
+
+  const Profiler::Command& total = profiler.totals();
+  char line[128];
+  std::snprintf(line, sizeof(line), "%zu commands, %.3f ms wall\n", profiler.commands(), total.wall_ns / 1e6);
+  std::cout << line;
+  for (int p = 0; p < Profiler::PhaseCount; ++p) {
+    std::snprintf(line, sizeof(line), "  %-8s %12.3f ms\n", Profiler::phase_name(static_cast<Profiler::Phase>(p)),
+                  total.phase_ns[p] / 1e6);
+    std::cout << line;
+  }
+  std::snprintf(line, sizeof(line), "%zu children, user %.3f ms, sys %.3f ms, max rss %ld KiB\n", total.children,
+                total.child_user_us / 1e3, total.child_sys_us / 1e3, total.child_maxrss_kb);
+  std::cout << line << std::flush;
+}
+
+void Shell::run_fast(fastio::Builtin builtin, const std::vector<std::string>& arg_list) {
+  std::cout.flush(); // it writes to the fd, after what the shell already printed
+
+  // the shell ignores SIGINT while it owns the terminal, the builtin has to stop on it
+  std::optional<fastio::InterruptScope> interrupt;
+  if (job_control) interrupt.emplace();
+  last_status = builtin(arg_list, builtin_io);
+  if (interactive && last_status == 128 + SIGINT) std::cout << std::endl;
+}
+
+void Shell::handle_hash(const std::vector<std::string>& arg_list) {
+  if (arg_list.empty()) {
+    if (command_hash.empty()) {
+      std::cout << "hash: hash table empty" << std::endl;
+      return;
+    }
+
+    // hit count + time the PATH walk took when the entry was filled
+    std::ios_base::fmtflags flags = std::cout.flags();
+    std::streamsize precision = std::cout.precision();
+    std::cout << "hits\tcost(us)\tcommand" << std::endl;
+    for (const auto& [name, entry] : command_hash.entries()) {
+      std::cout << std::setw(4) << entry.hits << "\t"
+                << std::setw(8) << std::fixed << std::setprecision(1) << entry.resolve_ns / 1000.0 << "\t"
+                << entry.path << std::endl;
+    }
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+    return;
+  }
+
+  const std::string& opt = arg_list[0];
+
+  // -r : forget all remembered locations
+  if (opt == "-r") {
+    command_hash.clear();
+    return;
+  }
+
+  // -p path name : use path as the location of name
+  if (opt == "-p") {
+    if (arg_list.size() < 3) {
+      std::cerr << "hash: -p: usage: hash -p path name" << std::endl;
+      return;
+    }
+    command_hash.add(arg_list[2], arg_list[1]);
+    return;
+  }
+
+  // -d name : forget name
+  if (opt == "-d") {
+    for (size_t i = 1; i < arg_list.size(); ++i) {
+      if (!command_hash.remove(arg_list[i])) {
+        std::cerr << "hash: " << arg_list[i] << ": not found" << std::endl;
+        last_status = 1;
+      }
+    }
+    return;
+  }
+
+  // -t name : print the remembered location
+  if (opt == "-t") {
+    for (size_t i = 1; i < arg_list.size(); ++i) {
+      const CommandHash::Entry* entry = command_hash.find(arg_list[i]);
+      if (!entry) {
+        std::cerr << "hash: " << arg_list[i] << ": not found" << std::endl;
+        last_status = 1;
+      } else if (arg_list.size() > 2) {
+        std::cout << arg_list[i] << "\t" << entry->path << std::endl;
+      } else {
+        std::cout << entry->path << std::endl;
+      }
+    }
+    return;
+  }
+
+  // hash name... : resolve and remember without running
+  for (const auto& name : arg_list) {
+    if (builtins.contains(name)) continue;
+    if (find_in_path(name, false).empty()) {
+      std::cerr << "hash: " << name << ": not found" << std::endl;
+      last_status = 1;
+    }
+  }
+}
+
+void Shell::handle_cd(const std::vector<std::string>& arg_list) {
+  if (arg_list.empty()) return;
+  const std::string& path_str = arg_list[0];
+  std::filesystem::path targetDir;
+
+  if (path_str == "~") {
+    const std::string* home = variables.get("HOME");
+    targetDir = home ? *home : "/";
+  } else if (path_str.starts_with("/")) {
+    targetDir = path_str;
+  } else {
+    targetDir = curDir / path_str;
+  }
+
+  // clean up path
+  targetDir = std::filesystem::weakly_canonical(targetDir);
+
+  if (std::filesystem::is_directory(targetDir)) {
+    variables.set("OLDPWD", curDir.string());
+    curDir = targetDir;
+    std::filesystem::current_path(curDir); // Sync actual process dir
+    variables.set("PWD", curDir.string());
+  } else {
+    std::cerr << "cd: " << path_str << ": No such file or directory" << std::endl;
+    last_status = 1;
+  }
+}
+
+Expander Shell::expander() {
+  return Expander(variables, {last_status, shell_pid, last_background_pid},
+                  [this](std::string_view command, std::string& output) { return substitute(command, output); },
+                  options["noglob"] ? nullptr : &glob);
+}
+
+bool Shell::needs_expansion(const ast::Command& cmd) {
+  auto expands = [](const ast::Word& w) { return w.expand; };
+  return std::ranges::any_of(cmd.assignments, expands) || std::ranges::any_of(cmd.words, expands) ||
+         std::ranges::any_of(cmd.redirects, [](const ast::Redirect& r) { return r.target.expand; });
+}
+
+std::string_view Shell::arena_copy(std::string_view text, std::pmr::memory_resource* arena) {
+  char* copy = static_cast<char*>(arena->allocate(text.size() + 1, 1));
+  std::memcpy(copy, text.data(), text.size());
+  copy[text.size()] = '\0';
+  return {copy, text.size()};
+}
+
+ast::Command* Shell::expand(const ast::Command& cmd, std::pmr::memory_resource* arena) {
+  auto* out = std::pmr::polymorphic_allocator<ast::Command>(arena).new_object<ast::Command>(arena);
+  out->kind = cmd.kind;
+  out->body = cmd.body;
+  Expander exp = expander();
+  std::string text;
+  std::vector<std::string> fields;
+  auto failed = [&exp]() {
+    if (!exp.error().empty()) std::cerr << "shell: " << exp.error() << std::endl;
+    return nullptr;
+  };
+
+  for (const auto& assignment : cmd.assignments) {
+    if (!assignment.expand) {
+      out->assignments.push_back(assignment);
+      continue;
+    }
+    if (!exp.string(assignment.raw, text)) return failed();
+    out->assignments.push_back({arena_copy(text, arena), assignment.raw, true});
+  }
+
+  for (const auto& word : cmd.words) {
+    if (!word.expand) {
+      out->words.push_back(word);
+      continue;
+    }
+    fields.clear();
+    if (!exp.fields(word.raw, fields)) return failed();
+    for (const auto& field : fields) out->words.push_back({arena_copy(field, arena), word.raw, true});
+  }
+
+  for (auto redirect : cmd.redirects) {
+    if (redirect.target.expand) {
+      if (redirect.kind == ast::Redirect::HereDoc) {
+        if (!exp.heredoc(redirect.target.text, text)) return failed();
+      } else {
+        fields.clear();
+        if (!exp.fields(redirect.target.raw, fields)) return failed();
+        if (fields.size() != 1) {
+          std::cerr << "shell: " << redirect.target.raw << ": ambiguous redirect" << std::endl;
+          return nullptr;
+        }
+        text = std::move(fields[0]);
+      }
+      redirect.target = {arena_copy(text, arena), redirect.target.raw, true};
+    }
+    out->redirects.push_back(redirect);
+  }
+  return out;
+}
+
+const ast::Pipeline* Shell::expand(const ast::Pipeline& pipeline, std::pmr::memory_resource* arena) {
+  if (std::ranges::none_of(pipeline.commands, [](const ast::Command* cmd) { return needs_expansion(*cmd); })) {
+    return &pipeline;
+  }
+
+  auto* out = std::pmr::polymorphic_allocator<ast::Pipeline>(arena).new_object<ast::Pipeline>(arena);
+  out->text = pipeline.text;
+  for (ast::Command* cmd : pipeline.commands) {
+    ast::Command* expanded = needs_expansion(*cmd) ? expand(*cmd, arena) : cmd;
+    if (!expanded) return nullptr;
+    out->commands.push_back(expanded);
+  }
+  return out;
+}
+
+bool Shell::substitute(std::string_view command, std::string& out) {
+  std::array<std::byte, 2048> initial;
+  std::pmr::monotonic_buffer_resource arena(initial.data(), initial.size());
+  ast::List* list = nullptr;
+  Parser parser(command, &arena);
+  if (parser.parse(list) != Parser::Ok) {
+    std::cerr << "shell: syntax error in command substitution near '" << parser.error_token() << "'" << std::endl;
+    return false;
+  }
+  out.clear();
+
+  // a single simple command is expanded here, once, whichever way it then runs
+  const ast::Command* lone = nullptr;
+  if (list->items.size() == 1 && !list->items[0].background && list->items[0].and_or->rest.empty()) {
+    const ast::Pipeline& pipeline = *list->items[0].and_or->first;
+    if (pipeline.commands.size() == 1 && pipeline.commands[0]->kind == ast::Command::Simple) {
+      const ast::Pipeline* expanded = expand(pipeline, &arena);
+      if (!expanded) return false;
+      lone = expanded->commands[0];
+    }
+  }
+
+  int status = 0;
+  if (lone && !lone->words.empty() && captures_in_shell(*lone)) {
+    capture_builtin(*lone, &arena, out);
+    status = last_status;
+  } else {
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) == -1) {
+      perror("pipe");
+      return false;
+    }
+    fcntl(fds[1], F_SETPIPE_SZ, SUBSTITUTION_PIPE_SIZE); // best effort, the default is 64 KiB
+
+    pid_t pid = -1;
+    if (lone && !lone->words.empty() && !runs_in_shell(*lone)) {
+      // stays in the shell's process group, like the shell it stands for
+      Redirections redirections;
+      status = 1;
+      if (redirections.prepare(lone->redirects)) {
+        pid = spawn_stage(*lone, redirections, -1, fds[1], -1, &arena, status);
+      }
+    } else {
+      std::cout.flush();
+      {
+        Profiler::Span span(profiler, Profiler::Spawn, "fork");
+        pid = fork();
+      }
+      if (pid == 0) {
+        job_control = false; // no process group of its own
+        enter_subshell(0, false);
+        dup2(fds[1], STDOUT_FILENO);
+        if (lone) run_in_shell(*lone, &arena);
+        else run_list(*list, &arena);
+        std::cout.flush();
+        exit(last_status);
+      }
+      if (pid < 0) perror("fork");
+    }
+    close(fds[1]);
+    read_all(fds[0], out);
+    close(fds[0]);
+
+    if (pid > 0) {
+      Profiler::Span span(profiler, Profiler::Wait, "substitution");
+      int raw = 0;
+      while (waitpid(pid, &raw, 0) < 0 && errno == EINTR) {}
+      status = WIFSIGNALED(raw) ? 128 + WTERMSIG(raw) : WEXITSTATUS(raw);
+      // Ctrl-C drops the whole command, not just the substitution
+      if (WIFSIGNALED(raw) && WTERMSIG(raw) == SIGINT) {
+        if (interactive) std::cout << std::endl;
+        return false;
+      }
+    }
+  }
+
+  while (!out.empty() && out.back() == '\n') out.pop_back();
+  last_status = status;
+  substitution_status = status;
+  return true;
+}
+
+bool Shell::captures_in_shell(const ast::Command& cmd) {
+  std::string_view name = cmd.words[0].text;
+  if (fastio::find(name)) return fast_builtin(cmd) != nullptr;
+  return name == "echo" || name == "pwd" || name == "type" || name == "times";
+}
+
+void Shell::capture_builtin(const ast::Command& cmd, std::pmr::memory_resource* arena, std::string& out) {
+  if (cmd.redirects.empty() && !fastio::find(cmd.words[0].text)) {
+    std::stringbuf buffer;
+    std::streambuf* shell_out = std::cout.rdbuf(&buffer);
+    run_builtin(cmd.words);
+    std::cout.rdbuf(shell_out);
+    out = std::move(buffer).str();
+    return;
+  }
+
+  int fd = memfd_create("shell-substitution", MFD_CLOEXEC);
+  if (fd < 0) {
+    perror("memfd_create");
+    last_status = 1;
+    return;
+  }
+  // >&fd in front of the command's own redirections, so 2>&1 means the memfd too
+  auto* captured = std::pmr::polymorphic_allocator<ast::Command>(arena).new_object<ast::Command>(arena);
+  captured->words = cmd.words;
+  captured->redirects.push_back({ast::Redirect::Dup, STDOUT_FILENO, {arena_copy(std::to_string(fd), arena), {}}});
+  captured->redirects.insert(captured->redirects.end(), cmd.redirects.begin(), cmd.redirects.end());
+  run_in_shell(*captured, arena);
+
+  struct stat st{};
+  if (fstat(fd, &st) == 0) {
+    out.resize(st.st_size);
+    size_t got = 0;
+    while (got < out.size()) {
+      ssize_t n = pread(fd, out.data() + got, out.size() - got, got);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) break;
+      got += n;
+    }
+    out.resize(got);
+  }
+  close(fd);
+}
+
+void Shell::read_all(int fd, std::string& out) {
+  size_t chunk = 64 << 10;
+  while (true) {
+    size_t have = out.size();
+    out.resize(have + chunk);
+    ssize_t n = read(fd, out.data() + have, chunk);
+    out.resize(have + (n > 0 ? n : 0));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return;
+    if (chunk < SUBSTITUTION_PIPE_SIZE) chunk *= 2;
+  }
+}
+
+void Shell::run_list(const ast::List& list, std::pmr::memory_resource* arena) {
+  for (const auto& item : list.items) {
+    if (!running) return;
+    if (item.background) run_background(*item.and_or, arena);
+    else run_and_or(*item.and_or, arena);
+  }
+}
+
+void Shell::run_and_or(const ast::AndOr& and_or, std::pmr::memory_resource* arena) {
+  run_pipeline(*and_or.first, false, arena);
+  for (const auto& [op, pipeline] : and_or.rest) {
+    if (!running) return;
+    // && goes on after success, || after failure
+    if ((op == ast::AndOr::And) == (last_status == 0)) run_pipeline(*pipeline, false, arena);
+  }
+}
+
+void Shell::run_background(const ast::AndOr& and_or, std::pmr::memory_resource* arena) {
+  if (and_or.rest.empty()) {
+    run_pipeline(*and_or.first, true, arena);
+    return;
+  }
+
+  std::cout.flush();
+  pid_t pid;
+  {
+    Profiler::Span span(profiler, Profiler::Spawn, "fork");
+    pid = fork();
+  }
+  if (pid == 0) {
+    enter_subshell(0, true);
+    run_and_or(and_or, arena);
+    exit(last_status);
+  }
+  if (pid < 0) {
+    perror("fork");
+    return;
+  }
+  if (job_control) setpgid(pid, pid);
+
+  JobTable::Job& job = jobs.add(job_control ? pid : getpgrp(), {pid}, std::string(and_or.text), true);
+  last_background_pid = pid;
+  last_status = 0;
+  if (interactive) std::cout << "[" << job.id << "] " << pid << std::endl;
+}
+
+void Shell::run_pipeline(const ast::Pipeline& unexpanded, bool background, std::pmr::memory_resource* arena) {
+  substitution_status.reset();
+  const ast::Pipeline* expanded = expand(unexpanded, arena);
+  if (!expanded) {
+    last_status = 1;
+    return;
+  }
+  const ast::Pipeline& pipeline = *expanded;
+
+  // a lone builtin or { group } runs in the shell itself, unless it goes to the background
+  if (!background && pipeline.commands.size() == 1) {
+    const ast::Command& cmd = *pipeline.commands[0];
+    if (cmd.kind == ast::Command::Group || (cmd.kind == ast::Command::Simple && runs_in_shell(cmd))) {
+      run_in_shell(cmd, arena);
+      return;
+    }
+  }
+  handle_pipeline(pipeline, background, arena);
+}
+
+bool Shell::runs_in_shell(const ast::Command& cmd) {
+  if (cmd.words.empty()) return true;
+  // command name: skips the in-shell cat / head / ..., other builtins stay builtins
+  if (cmd.words[0].text == "command" && cmd.words.size() > 1 && !cmd.words[1].text.starts_with('-')) {
+    return commands.contains(cmd.words[1].text) && !fastio::find(cmd.words[1].text);
+  }
+  if (fastio::find(cmd.words[0].text)) return fast_builtin(cmd) != nullptr;
+  return commands.contains(cmd.words[0].text);
+}
+
+fastio::Builtin Shell::fast_builtin(const ast::Command& cmd) {
+  if (cmd.kind != ast::Command::Simple || cmd.words.empty()) return nullptr;
+  fastio::Builtin builtin = fastio::find(cmd.words[0].text);
+  if (!builtin) return nullptr;
+  std::vector<std::string> args;
+  for (size_t w = 1; w < cmd.words.size(); ++w) args.emplace_back(cmd.words[w].text);
+  return fastio::supports(cmd.words[0].text, args) ? builtin : nullptr;
+}
+
+fastio::Io Shell::stage_io(const Redirections& redirections, int in_fd, int out_fd) {
+  int base[3] = {in_fd != -1 ? in_fd : STDIN_FILENO, out_fd != -1 ? out_fd : STDOUT_FILENO, STDERR_FILENO};
+  auto shell_fd = [&](int fd) {
+    int r = redirections.resolve(fd);
+    return r >= 0 && r <= 2 ? base[r] : r;
+  };
+  return {shell_fd(STDIN_FILENO), shell_fd(STDOUT_FILENO), shell_fd(STDERR_FILENO)};
+}
+
+void Shell::run_in_shell(const ast::Command& cmd, std::pmr::memory_resource* arena) {
+  Redirections redirections;
+  if (!redirections.prepare(cmd.redirects)) {
+    last_status = 1;
+    return;
+  }
+
+  if (cmd.kind == ast::Command::Group) {
+    // anything can run inside the group, it needs the real fds for as long as it runs
+    std::vector<std::pair<int, int>> saved;
+    std::cout.flush();
+    redirections.apply(&saved);
+    run_list(*cmd.body, arena);
+    std::cout.flush();
+    Redirections::restore(saved);
+  } else if (!cmd.words.empty()) {
+    // NAME=value in front of a builtin is not applied
+    run_builtin(cmd.words, &redirections);
+  } else {
+    // only assignments and redirections: files are created, variables set, nothing runs
+    for (const auto& assignment : cmd.assignments) {
+      size_t eq = assignment.text.find('=');
+      assign(assignment.text.substr(0, eq), std::string(assignment.text.substr(eq + 1)));
+    }
+    last_status = substitution_status.value_or(0);
+  }
+}
+
+void Shell::run_builtin(const std::pmr::vector<ast::Word>& words, const Redirections* redirections) {
+  std::vector<std::string> args;
+  args.reserve(words.size() - 1);
+  for (size_t i = 1; i < words.size(); ++i) args.emplace_back(words[i].text);
+
+  std::optional<FdStreambuf> out, err;
+  std::streambuf* shell_out = nullptr;
+  std::streambuf* shell_err = nullptr;
+  builtin_io = {};
+  if (redirections) {
+    builtin_io = stage_io(*redirections, -1, -1);
+    int out_fd = redirections->resolve(STDOUT_FILENO);
+    int err_fd = redirections->resolve(STDERR_FILENO);
+    if (out_fd != STDOUT_FILENO) {
+      std::cout.flush();
+      shell_out = std::cout.rdbuf(&out.emplace(out_fd));
+    }
+    if (err_fd != STDERR_FILENO) shell_err = std::cerr.rdbuf(&err.emplace(err_fd));
+  }
+
+  last_status = 0; // a failing builtin sets its own
+  {
+    Profiler::Span span(profiler, Profiler::Builtin, words[0].text);
+    commands.find(words[0].text)->second(args);
+  }
+
+  if (shell_out) {
+    std::cout.flush();
+    std::cout.rdbuf(shell_out);
+  }
+  if (shell_err) std::cerr.rdbuf(shell_err);
+}
+
+void Shell::enter_subshell(pid_t pgid, bool background) {
+  if (job_control) setpgid(0, pgid);
+  reset_child_signals();
+
+  // without job control a background job must not read the terminal
+  if (background && !job_control) {
+    int null_fd = open("/dev/null", O_RDONLY);
+    if (null_fd >= 0) {
+      dup2(null_fd, STDIN_FILENO);
+      close(null_fd);
+    }
+  }
+
+  job_control = false;
+  interactive = false;
+  jobs.all().clear();
+  profiler.disable();
+}
+
+void Shell::handle_pipeline(const ast::Pipeline& pipeline, bool background, std::pmr::memory_resource* arena) {
+  size_t num_cmds = pipeline.commands.size();
+  int prev_pipe_read_end = -1;
+  std::vector<pid_t> pids;
+  std::vector<ThreadStage> thread_stages;
+  std::vector<int> thread_fds; // forked stages close these
+  bool last_is_thread = false;
+  pid_t pgid = 0; // with job control every pipeline gets its own process group, led by the first stage
+  int start_failure = 0; // status of a last stage that could not be started
+  std::cout.flush();
+
+  // without job control a background job must not read the terminal
+  if (background && !job_control) {
+    prev_pipe_read_end = open("/dev/null", O_RDONLY | O_CLOEXEC);
+  }
+
+  for (size_t i = 0; i < num_cmds; ++i) {
+    int pipefds[2];
+
+    // create pipe for all but last, exec closes the ends a spawned stage doesn't use
+    if (i < num_cmds - 1) {
+      if (pipe2(pipefds, O_CLOEXEC) == -1) {
+        perror("pipe");
+        break;
+      }
+    }
+
+    const ast::Command& stage = *pipeline.commands[i];
+    pid_t pid = -1;
+    start_failure = 0;
+
+    // files and here-doc memfds are opened here, the child only dup2s them
+    Redirections redirections;
+    bool prepared = redirections.prepare(stage.redirects);
+    fastio::Builtin fast = prepared && !background ? fast_builtin(stage) : nullptr;
+    fastio::Io io;
+    std::vector<std::string> args;
+    if (fast) {
+      for (size_t w = 1; w < stage.words.size(); ++w) args.emplace_back(stage.words[w].text);
+      io = stage_io(redirections, prev_pipe_read_end, i < num_cmds - 1 ? pipefds[1] : -1);
+      // reading the terminal takes a process in the job's group
+      if (isatty(io.in) && fastio::uses_stdin(stage.words[0].text, args)) fast = nullptr;
+    }
+    last_is_thread = fast != nullptr;
+
+    if (!prepared) {
+      start_failure = 1;
+    } else if (fast) {
+      // the pipe ends and files are closed below like for any stage, the thread keeps duplicates
+      auto own = [&thread_fds](int fd) {
+        if (fd < 0) return -1;
+        int copy = fcntl(fd, F_DUPFD_CLOEXEC, 10);
+        if (copy >= 0) thread_fds.push_back(copy);
+        return copy;
+      };
+      thread_stages.push_back({fast, std::move(args), {own(io.in), own(io.out), own(io.err)}});
+    } else if (stage.kind != ast::Command::Simple || runs_in_shell(stage)) {
+      // builtins and ( ) / { } need a subshell to run next to the other stages
+      {
+        Profiler::Span span(profiler, Profiler::Spawn, "fork");
+        pid = fork();
+      }
+      if (pid == 0) { // child
+        enter_subshell(pgid, false);
+        for (int fd : thread_fds) close(fd);
+
+        // get input from previous pipe
+        if (prev_pipe_read_end != -1) {
+          dup2(prev_pipe_read_end, STDIN_FILENO);
+          close(prev_pipe_read_end);
+        }
+
+        // send output to the current pipe
+        if (i < num_cmds - 1) {
+          close(pipefds[0]); // Close unused read end
+          dup2(pipefds[1],STDOUT_FILENO);
+          close(pipefds[1]);
+        }
+
+        redirections.apply();
+        if (stage.kind != ast::Command::Simple) run_list(*stage.body, arena);
+        else if (!stage.words.empty()) run_builtin(stage.words);
+        else last_status = 0;
+        exit(last_status);
+      }
+
+      if (pid < 0) perror("fork");
+      else if (job_control) setpgid(pid, pgid ? pgid : pid); // whoever runs first, the group exists
+    } else {
+      pid = spawn_stage(stage, redirections, prev_pipe_read_end, i < num_cmds - 1 ? pipefds[1] : -1, pgid, arena,
+                        start_failure);
+    }
+
+    if (pid > 0) {
+      pids.push_back(pid);
+      if (pgid == 0 && job_control) pgid = pid;
+    }
+
+    if (prev_pipe_read_end != -1) close(prev_pipe_read_end);
+    prev_pipe_read_end = -1;
+    if (i < num_cmds - 1) {
+      close(pipefds[1]); // parent doesn't write
+      prev_pipe_read_end = pipefds[0]; // save read end for next child
+    }
+  }
+
+  if (prev_pipe_read_end != -1) close(prev_pipe_read_end);
+  if (pids.empty() && thread_stages.empty()) {
+    last_status = start_failure;
+    return;
+  }
+
+  // threads start once every process is forked
+  std::optional<fastio::InterruptScope> interrupt;
+  if (job_control && !thread_stages.empty()) interrupt.emplace();
+  std::vector<int> thread_status(thread_stages.size());
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < thread_stages.size(); ++t) {
+    threads.emplace_back([&stage = thread_stages[t], &status = thread_status[t]]() {
+      status = stage.builtin(stage.args, stage.io);
+      // closing the write end is the next stage's EOF
+      for (int fd : {stage.io.in, stage.io.out, stage.io.err}) {
+        if (fd >= 0) close(fd);
+      }
+    });
+  }
+
+  // SIGINT has to land on a stage thread to break it out of a blocking read
+  sigset_t sigint, shell_mask;
+  sigemptyset(&sigint);
+  sigaddset(&sigint, SIGINT);
+  if (!threads.empty()) pthread_sigmask(SIG_BLOCK, &sigint, &shell_mask);
+
+  if (!pids.empty()) {
+    JobTable::Job& job = jobs.add(job_control ? pgid : getpgrp(), pids, std::string(pipeline.text), background);
+
+    if (background) {
+      last_background_pid = pids.back();
+      last_status = 0;
+      if (interactive) std::cout << "[" << job.id << "] " << pids.back() << std::endl;
+      return;
+    }
+
+    wait_foreground(job, threads.empty());
+  }
+
+  if (!threads.empty()) {
+    Profiler::Span span(profiler, Profiler::Wait, "threads");
+    for (auto& thread : threads) thread.join();
+  }
+  if (!threads.empty()) pthread_sigmask(SIG_SETMASK, &shell_mask, nullptr);
+
+  if (last_is_thread) {
+    last_status = thread_status.back();
+    if (interactive && last_status == 128 + SIGINT) std::cout << std::endl;
+  } else if (start_failure || pids.empty()) {
+    last_status = start_failure;
+  }
+}
+
+pid_t Shell::spawn_stage(const ast::Command& stage, const Redirections& redirections, int in_fd, int out_fd, pid_t pgid,
+                         std::pmr::memory_resource* arena, int& failure) {
+  // command cat ...: the program, not the builtin
+  size_t first = stage.words[0].text == "command" && stage.words.size() > 1 ? 1 : 0;
+  std::string name(stage.words[first].text);
+  std::string full_path = find_in_path(name);
+  if (full_path.empty()) {
+    std::cerr << name << ": command not found" << std::endl;
+    failure = 127;
+    return -1;
+  }
+
+  // pipe ends first, the stage's own redirections are applied on top of them
+  std::vector<FdAction> actions;
+  if (in_fd != -1) actions.push_back(FdAction::dup2(in_fd, STDIN_FILENO));
+  if (out_fd != -1) actions.push_back(FdAction::dup2(out_fd, STDOUT_FILENO));
+  actions.insert(actions.end(), redirections.actions().begin(), redirections.actions().end());
+
+  // NUL terminated copies of the words, from the same arena as the tree
+  std::pmr::vector<char*> argv(arena);
+  argv.reserve(stage.words.size() + 1);
+  for (const auto& word : std::span(stage.words).subspan(first)) {
+    char* arg = static_cast<char*>(arena->allocate(word.text.size() + 1, 1));
+    std::memcpy(arg, word.text.data(), word.text.size());
+    arg[word.text.size()] = '\0';
+    argv.push_back(arg);
+  }
+  argv.push_back(nullptr);
+
+  // FOO=bar cmd: the cached environment plus FOO for this command only
+  std::vector<std::string> assignments, storage;
+  for (const auto& assignment : stage.assignments) assignments.emplace_back(assignment.text);
+  std::vector<char*> env_with;
+  char* const* envp = variables.envp();
+  if (!assignments.empty()) {
+    env_with = variables.envp_with(assignments, storage);
+    envp = env_with.data();
+  }
+
+  pid_t pid;
+  {
+    Profiler::Span span(profiler, Profiler::Spawn, name);
+    pid = spawn_process(full_path.c_str(), argv.data(), actions, job_control ? pgid : -1, envp);
+    // the hashed program was removed since: forget it and walk PATH once more
+    if (pid < 0 && errno == ENOENT && name.find('/') == std::string::npos) {
+      command_hash.remove(name);
+      full_path = find_in_path(name);
+      if (full_path.empty()) {
+        std::cerr << name << ": command not found" << std::endl;
+        failure = 127;
+        return -1;
+      }
+      pid = spawn_process(full_path.c_str(), argv.data(), actions, job_control ? pgid : -1, envp);
+    }
+  }
+  if (pid < 0) {
+    std::cerr << name << ": " << std::strerror(errno) << std::endl;
+    failure = 126;
+  }
+  return pid;
+}
+
+void Shell::wait_foreground(JobTable::Job& job, bool can_stop) {
+  if (job_control) {
+    tcsetpgrp(STDIN_FILENO, job.pgid);
+    // a stage that touched the terminal before it owned it got SIGTTIN / SIGTTOU, let it go on
+    kill(-job.pgid, SIGCONT);
+  }
+
+  {
+    Profiler::Span span(profiler, Profiler::Wait, job.command);
+    jobs.wait_for(job);
+    while (!can_stop && job_control && job.stopped()) {
+      for (auto& proc : job.procs) proc.stopped = false;
+      kill(-job.pgid, SIGCONT);
+      jobs.wait_for(job);
+    }
+  }
+  if (profiler.enabled()) {
+    for (const auto& proc : job.procs) {
+      if (proc.done) profiler.add_child(proc.usage);
+    }
+  }
+
+  if (job_control) tcsetpgrp(STDIN_FILENO, shell_pgid);
+
+  if (job.stopped()) {
+    // Ctrl-Z: it's a background job from now on
+    job.background = true;
+    job.notified = true;
+    std::cout << "\n" << jobs.describe(job) << std::endl;
+    return;
+  }
+
+  last_status = job.exit_status();
+  if (interactive && last_status == 128 + SIGINT) std::cout << std::endl;
+  jobs.remove(job);
+}
+
+void Shell::init_job_control() {
+  if (!isatty(STDIN_FILENO)) return;
+
+  // wait until we are in the foreground
+  while (tcgetpgrp(STDIN_FILENO) != (shell_pgid = getpgrp())) {
+    kill(-shell_pgid, SIGTTIN);
+  }
+
+  // the terminal sends these to the foreground job, never to the shell
+  signal(SIGINT, SIG_IGN);
+  signal(SIGQUIT, SIG_IGN);
+  signal(SIGTSTP, SIG_IGN);
+  signal(SIGTTIN, SIG_IGN);
+  signal(SIGTTOU, SIG_IGN);
+
+  // own process group, unless we already lead one (session leader)
+  if (getpgrp() != getpid() && setpgid(0, 0) == 0) shell_pgid = getpid();
+  tcsetpgrp(STDIN_FILENO, shell_pgid);
+
+  // SIGCHLD is delivered through a signalfd the line editor polls next to stdin
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGCHLD);
+  sigprocmask(SIG_BLOCK, &mask, nullptr);
+  sigchld_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (sigchld_fd >= 0) {
+    editor.watch(sigchld_fd, [this]() { on_sigchld(); });
+  }
+
+  job_control = true;
+}
+
+void Shell::on_sigchld() {
+  signalfd_siginfo info[16];
+  while (read(sigchld_fd, info, sizeof(info)) > 0) {}
+
+  jobs.reap();
+  std::string text;
+  for (const auto& line : jobs.take_notifications()) {
+    if (!text.empty()) text += "\n";
+    text += line;
+  }
+  if (!text.empty()) editor.show_below(text);
+}
+
+void Shell::report_jobs() {
+  if (jobs.empty()) return;
+  jobs.reap();
+  for (const auto& line : jobs.take_notifications()) {
+    std::cout << line << std::endl;
+  }
+}
+
+void Shell::handle_jobs(const std::vector<std::string>& arg_list) {
+  bool pids_only = !arg_list.empty() && arg_list[0] == "-p";
+  bool with_pids = !arg_list.empty() && arg_list[0] == "-l";
+
+  jobs.reap();
+  for (auto& job : jobs.all()) {
+    if (pids_only) {
+      std::cout << job.pgid << std::endl;
+    } else if (with_pids) {
+      std::string line = jobs.describe(job);
+      size_t space = line.find(' ');
+      std::cout << line.substr(0, space) << " " << job.procs.front().pid << line.substr(space) << std::endl;
+    } else {
+      std::cout << jobs.describe(job) << std::endl;
+    }
+  }
+
+  // finished jobs are forgotten once they have been listed
+  jobs.all().remove_if([](const JobTable::Job& job) { return job.done(); });
+}
+
+JobTable::Job* Shell::job_from_args(const std::string& builtin, const std::vector<std::string>& arg_list) {
+  std::string spec = arg_list.empty() ? "" : arg_list[0];
+  JobTable::Job* job = jobs.find(spec);
+  if (!job) {
+    std::cerr << builtin << ": " << (spec.empty() ? "current" : spec) << ": no such job" << std::endl;
+    last_status = 1;
+  }
+  return job;
+}
+
+void Shell::handle_fg(const std::vector<std::string>& arg_list) {
+  if (!job_control) {
+    std::cerr << "fg: no job control" << std::endl;
+    last_status = 1;
+    return;
+  }
+  JobTable::Job* job = job_from_args("fg", arg_list);
+  if (!job) return;
+
+  std::cout << job->command << std::endl;
+  job->background = false;
+  for (auto& proc : job->procs) proc.stopped = false;
+  wait_foreground(*job);
+}
+
+void Shell::handle_bg(const std::vector<std::string>& arg_list) {
+  if (!job_control) {
+    std::cerr << "bg: no job control" << std::endl;
+    last_status = 1;
+    return;
+  }
+  JobTable::Job* job = job_from_args("bg", arg_list);
+  if (!job) return;
+
+  job->background = true;
+  for (auto& proc : job->procs) proc.stopped = false;
+  kill(-job->pgid, SIGCONT);
+  std::cout << "[" << job->id << "]+ " << job->command << " &" << std::endl;
+}
+
+void Shell::handle_wait(const std::vector<std::string>& arg_list) {
+  // no arguments: every background job
+  if (arg_list.empty()) {
+    for (auto& job : jobs.all()) {
+      if (job.background) jobs.wait_for(job);
+    }
+    jobs.all().remove_if([](const JobTable::Job& job) { return job.done(); });
+    last_status = 0;
+    return;
+  }
+
+  for (const auto& spec : arg_list) {
+    JobTable::Job* job = jobs.find(spec);
+    if (!job) {
+      std::cerr << "wait: " << spec << ": no such job" << std::endl;
+      last_status = 127;
+      continue;
+    }
+    jobs.wait_for(*job);
+    last_status = job->exit_status();
+    if (job->done()) jobs.remove(*job);
+  }
+}
+
+size_t Shell::histfile_size() {
+  const std::string* value = variables.get("HISTFILESIZE");
+  long n = value ? std::strtol(value->c_str(), nullptr, 10) : 0;
+  return n > 0 ? static_cast<size_t>(n) : 10000;
+}
+
+void Shell::add_history(const std::string& line) {
+  if (!history.record(line)) history_error(history.histfile());
+
+  if (history.needs_compaction()) {
+    history.compaction_started();
+    pool.submit([path = history.histfile(), keep = histfile_size()]() { History::compact(path, keep); });
+  }
+}
+
+void Shell::history_error(const std::filesystem::path& path_to_file) {
+  std::cerr << "Error opening file : " << path_to_file.string() << std::endl;
+}
+
+bool Shell::is_histfile(const std::filesystem::path& path) {
+  std::error_code ec;
+  return !history.histfile().empty() && std::filesystem::equivalent(path, history.histfile(), ec);
+}
+
+void Shell::handle_history(const std::vector<std::string>& arg_list) {
+
+
+  for (size_t i = 0; i < arg_list.size(); ++i) {
+
+    // -r command
+    if (arg_list[i] == "-r") {
+      // get filename
+      if (i+1 >= arg_list.size()) {
+        std::cout << "history : no filename given to -r" << std::endl;
+        return;
+      }
+
+      std::string last_cmd(history.empty() ? "" : history.back());
+      if (!history.load(arg_list[i+1])) history_error(arg_list[i+1]);
+      if (!last_cmd.empty()) history.prepend(last_cmd);
+      appending_until = 0;
+
+      return;
+    }
+
+    // -w command
+    if (arg_list[i] == "-w") {
+      // get filename
+      if (i+1 >= arg_list.size()) {
+        std::cout << "history : no filename given to -w" << std::endl;
+        return;
+      }
+
+      if (!history.write_to(arg_list[i+1])) {
+        history_error(arg_list[i+1]);
+      } else if (is_histfile(arg_list[i+1])) {
+        history.mark_synced();
+      }
+
+      return;
+    }
+
+    // -a command
+    if (arg_list[i] == "-a") {
+      // get filename
+      if (i+1 >= arg_list.size()) {
+        std::cout << "history : no filename given to -w" << std::endl;
+        return;
+      }
+
+      // HISTFILE already has every recorded entry
+      if (is_histfile(arg_list[i+1]) ? !history.sync_histfile()
+                                     : !history.append_to(arg_list[i+1], std::min(appending_until, history.size()))) {
+        history_error(arg_list[i+1]);
+      }
+
+      appending_until = history.size();
+
+      return;
+    }
+  }
+
+  size_t total = history.size();
+  size_t first = 0;
+  try {
+    if (!arg_list.empty()) {
+      long count = stol(arg_list[0]);
+      first = count < 0 || static_cast<size_t>(count) >= total ? 0 : total - count;
+    }
+  } catch (std::exception& e ) {
+    first = 0;
+    std::cout << "std::invalid_argument::what(): " << e.what() << '\n';
+  }
+
+  for (size_t i = first; i < total; ++i) {
+      std::cout << "    " << i+1 << "  " << history[i] << '\n';
+  }
+}
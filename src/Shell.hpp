@@ -0,0 +1,294 @@
+#ifndef SHELL_STARTER_CPP_SHELL_H
+#define SHELL_STARTER_CPP_SHELL_H
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+#include "CommandHash.hpp"
+#include "CompletionWorker.hpp"
+#include "DirCache.hpp"
+#include "Expander.hpp"
+#include "FastIO.hpp"
+#include "Frecency.hpp"
+#include "FuzzyIndex.hpp"
+#include "Glob.hpp"
+#include "History.hpp"
+#include "HistoryIndex.hpp"
+#include "Jobs.hpp"
+#include "LineEditor.hpp"
+#include "Parser.hpp"
+#include "PathIndex.hpp"
+#include "PathWatcher.hpp"
+#include "Profiler.hpp"
+#include "Redirect.hpp"
+#include "ThreadPool.hpp"
+#include "Trie.hpp"
+#include "Variables.hpp"
+
+// The shell: builtins, parser driven execution, jobs, line editing, history and completion.
+// Built into shell_core, so main() and shell_bench construct the very same thing.
+class Shell {
+public:
+  explicit Shell(bool interactive = true);
+
+  ~Shell();
+
+  void run();
+
+  // non-interactive: read fd through a large buffer and run it line by line
+  void run_script(int fd);
+
+  // shell -c 'cmd'
+  void run_string(const std::string& script);
+
+  // exit status of the last command, what the shell exits with
+  int status() const { return last_status; }
+
+  // blocks until every PATH directory is in the completion index
+  void wait_for_index();
+
+private:
+  // whether line may end a here-doc waiting for delimiter (<<- strips the tabs, so they're always ignored here)
+  static bool delimiter_line(std::string_view line, std::string_view delimiter);
+
+  // the word the cursor is in, as the lexer will see it
+  struct CompletionWord {
+    std::string text;  // quotes and backslashes removed
+    char quote = 0;    // ' or " when the word has an open quote
+    bool command = true; // first word of a command
+    size_t start = 0;    // where the word begins in the line
+    std::string command_name; // of the command the word is an argument of
+  };
+
+  static CompletionWord completion_word(std::string_view line);
+
+  // what the line needs so that the lexer reads text back as the word it is
+  static std::string escape_for(std::string_view text, char quote);
+
+  // TAB: command names for the first word, file names for the others.
+  // The walk runs on the completion worker, on_completion() finishes the job once all matches are in.
+  void complete(LineEditor& editor, int tabs);
+
+  // a batch of matches from the worker
+  void on_completion();
+
+  void cancel_completion();
+
+  // sorted down the columns like readline, as many columns as the terminal is wide
+  static std::vector<std::string> format_columns(const std::vector<CompletionWorker::Match>& matches);
+
+  // parses and runs one input, false when it ended early and more_input says more lines may follow
+  // waiting_for: set to the here-doc delimiter an incomplete input still needs, cleared otherwise
+  bool execute_line(std::string_view input, bool more_input = false, std::string* waiting_for = nullptr);
+
+  std::filesystem::path curDir;
+  bool running;
+  bool interactive; // terminal with line editor, history and completion
+  std::map<std::string, std::function<void(std::vector<std::string>)>, std::less<>> commands;
+  std::unordered_set<std::string> builtins{"exit", "echo", "type","pwd", "cd","history", "hash",
+                                          "jobs", "fg", "bg", "wait", "command", "set", "times", "export", "unset"};
+  std::mutex index_mutex; // command_trie and path_index merges, shared with the completion worker
+  Trie command_trie;
+  DirCache dir_cache; // file name completion, only used by the completion worker
+  FuzzyIndex fuzzy_index; // set -o fuzzy, rebuilt when command_trie changed
+  CommandHash command_hash;
+  ThreadPool pool; // work next to the prompt, started on first use
+  Glob glob{&pool}; // pathname expansion, its ** walks share the pool
+  PathIndex path_index;
+  PathWatcher path_watcher;
+  LineEditor editor;
+  // TAB being worked on: the word it was pressed on and the matches that came back so far
+  struct PendingCompletion {
+    uint64_t request = 0; // 0: none
+    CompletionWord word;
+    std::string base; // what every match starts with
+    bool path = false;
+    bool fuzzy = false; // matches are ranked, not sorted
+    int tabs = 1;
+    std::vector<CompletionWorker::Match> matches;
+  };
+  static constexpr size_t COMPLETION_QUERY_ITEMS = 100; // longer lists ask first, like readline
+  static constexpr size_t FUZZY_LIMIT = 60;              // best fuzzy matches listed
+  // how long a command name completion waits for stale PATH directories before listing what it has
+  static constexpr std::chrono::milliseconds PATH_SCAN_WAIT{200};
+  PendingCompletion completion;
+  CompletionWorker completion_worker; // declared after what its walks read, so it stops first
+  JobTable jobs;
+  bool job_control = false; // own process groups + terminal hand-over, interactive only
+  pid_t shell_pgid = 0;
+  int sigchld_fd = -1;
+  pid_t last_background_pid = 0;
+  pid_t shell_pid = getpid(); // $$, subshells keep it
+  Variables variables;
+  bool path_changed = false; // PATH was assigned, the completion index is for the old one
+  std::optional<int> substitution_status; // of the last $( ) in the command being expanded
+  static constexpr size_t SUBSTITUTION_PIPE_SIZE = 1 << 20; // $( ) output an external command writes in one go
+  int last_status = 0;
+  History history;
+  HistoryIndex history_index; // built on the first Ctrl-R, then only extended
+  Frecency frecency;
+  std::filesystem::path frecency_path; // <HISTFILE>.frecency
+  size_t appending_until = 0;
+  fastio::Io builtin_io; // where the running builtin's fds 0 / 1 / 2 point
+  Profiler profiler;
+  std::map<std::string, bool, std::less<>> options{{"profile", false}, {"fuzzy", false}, {"noglob", false}}; // set -o
+
+  // most used first, the others stay sorted after them
+  void rank(PendingCompletion& job);
+
+  // commands and arguments of an input that is about to run, for rank()
+  void note_usage(const ast::List& list);
+
+  void handle_exit(const std::vector<std::string>& arg_list = {});
+
+  void add_command_to_Trie(Trie& command_trie);
+
+  void watch_path();
+
+  // brings the trie and the hash up to date with what the watcher saw since the last call
+  void sync_path();
+
+  std::string find_in_path(const std::string& cmd, bool count_hit = true);
+
+  // NAME=value at the prompt, export and unset
+  void assign(std::string_view name, std::string value);
+
+  void variable_changed(std::string_view name);
+
+  void handle_export(const std::vector<std::string>& arg_list);
+
+  void handle_unset(const std::vector<std::string>& arg_list);
+
+  void handle_echo(const std::vector<std::string>& arg_list);
+
+  void handle_type(const std::vector<std::string>& arg_list);
+
+  // command -v name... : what would run, command name args : the builtin (cat & co. are spawned, see runs_in_shell)
+  void handle_command(const std::vector<std::string>& arg_list);
+
+  // set -o : list the options, set -o name / set +o name : turn one on / off
+  void handle_set(const std::vector<std::string>& arg_list);
+
+  // times : user / system time of the shell, then of its children
+  // times -v : where the profiled commands spent their time, times -t file : the SHELLCPP_TRACE session so far
+  void handle_times(const std::vector<std::string>& arg_list);
+
+  void run_fast(fastio::Builtin builtin, const std::vector<std::string>& arg_list);
+
+  void handle_hash(const std::vector<std::string>& arg_list);
+
+  void handle_cd(const std::vector<std::string>& arg_list);
+
+  Expander expander();
+
+  static bool needs_expansion(const ast::Command& cmd);
+
+  static std::string_view arena_copy(std::string_view text, std::pmr::memory_resource* arena);
+
+  // the command as it runs: $ expanded in its assignments, words and redirection targets, unquoted results split
+  // into fields. nullptr after an error, which is reported.
+  ast::Command* expand(const ast::Command& cmd, std::pmr::memory_resource* arena);
+
+  // every stage expanded before any of them starts, pipeline itself when nothing has a $
+  const ast::Pipeline* expand(const ast::Pipeline& pipeline, std::pmr::memory_resource* arena);
+
+  // $(command) / `command`: what it wrote, trailing newlines removed. Builtins that leave the shell as it is run
+  // right here with their output captured, a lone external command is spawned onto a pipe, anything else runs in
+  // a forked subshell. Its status becomes the status of a command that only assigns.
+  bool substitute(std::string_view command, std::string& out);
+
+  // builtins a $( ) can run without a subshell: they change nothing in the shell
+  bool captures_in_shell(const ast::Command& cmd);
+
+  // std::cout into a string; cat / head / ... write to fds, their output (and anything redirected) goes to a memfd
+  void capture_builtin(const ast::Command& cmd, std::pmr::memory_resource* arena, std::string& out);
+
+  // everything up to EOF, in reads that grow up to 1 MiB
+  static void read_all(int fd, std::string& out);
+
+  void run_list(const ast::List& list, std::pmr::memory_resource* arena);
+
+  void run_and_or(const ast::AndOr& and_or, std::pmr::memory_resource* arena);
+
+  // a plain pipeline becomes the job itself, a && / || chain runs in a subshell that is the job
+  void run_background(const ast::AndOr& and_or, std::pmr::memory_resource* arena);
+
+  void run_pipeline(const ast::Pipeline& unexpanded, bool background, std::pmr::memory_resource* arena);
+
+  bool runs_in_shell(const ast::Command& cmd);
+
+  // cat / head / ... as a pipeline stage, nullptr for anything else and for options only the program has
+  fastio::Builtin fast_builtin(const ast::Command& cmd);
+
+  // the shell fds a stage's 0 / 1 / 2 end up on, pipe ends first and its redirections on top
+  static fastio::Io stage_io(const Redirections& redirections, int in_fd, int out_fd);
+
+  void run_in_shell(const ast::Command& cmd, std::pmr::memory_resource* arena);
+
+  // redirections: the builtin runs in the shell, its std::cout / std::cerr are pointed at the redirected fds
+  void run_builtin(const std::pmr::vector<ast::Word>& words, const Redirections* redirections = nullptr);
+
+  // forked child that runs shell code: no terminal handling, no jobs of its own
+  void enter_subshell(pid_t pgid, bool background);
+
+  // cat / head / ... in a foreground pipeline: a thread of the shell on its own copies of the stage's fds
+  struct ThreadStage {
+    fastio::Builtin builtin;
+    std::vector<std::string> args;
+    fastio::Io io;
+  };
+
+  void handle_pipeline(const ast::Pipeline& pipeline, bool background, std::pmr::memory_resource* arena);
+
+  // external stage: pipe ends and redirections become file actions, the shell is never forked
+  pid_t spawn_stage(const ast::Command& stage, const Redirections& redirections, int in_fd, int out_fd, pid_t pgid,
+                    std::pmr::memory_resource* arena, int& failure);
+
+  // hands the terminal to job and waits until it finishes or stops
+  // can_stop false: shell threads are part of the job, a Ctrl-Z can't stop those so the rest goes on too
+  void wait_foreground(JobTable::Job& job, bool can_stop = true);
+
+  void init_job_control();
+
+  // a child changed state while the user is typing: report it above the prompt
+  void on_sigchld();
+
+  void report_jobs();
+
+  void handle_jobs(const std::vector<std::string>& arg_list);
+
+  JobTable::Job* job_from_args(const std::string& builtin, const std::vector<std::string>& arg_list);
+
+  void handle_fg(const std::vector<std::string>& arg_list);
+
+  void handle_bg(const std::vector<std::string>& arg_list);
+
+  void handle_wait(const std::vector<std::string>& arg_list);
+
+  // newest distinct lines HISTFILE is compacted to
+  size_t histfile_size();
+
+  void add_history(const std::string& line);
+
+  void history_error(const std::filesystem::path& path_to_file);
+
+  // history -w / -a on HISTFILE itself, exit doesn't have to write those entries again
+  bool is_histfile(const std::filesystem::path& path);
+
+  void handle_history(const std::vector<std::string>& arg_list);
+};
+
+
+#endif //SHELL_STARTER_CPP_SHELL_H
@@ -0,0 +1,80 @@
+#include "Spawn.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <spawn.h>
+#include <unistd.h>
+
+// Process launching without fork()
+
+extern char** environ;
+
+namespace {
+    // what an interactive shell ignores or blocks
+    constexpr int SHELL_SIGNALS[] = {SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU, SIGCHLD, SIGPIPE};
+}
+
+void reset_child_signals() {
+    for (int sig : SHELL_SIGNALS) signal(sig, SIG_DFL);
+    sigset_t empty;
+    sigemptyset(&empty);
+    sigprocmask(SIG_SETMASK, &empty, nullptr);
+}
+
+pid_t spawn_process(const char* path, char* const argv[], const std::vector<FdAction>& actions, pid_t pgroup,
+                    char* const envp[]) {
+    posix_spawn_file_actions_t file_actions;
+    posix_spawn_file_actions_init(&file_actions);
+
+    for (const auto& action : actions) {
+        switch (action.kind) {
+            case FdAction::Dup2:
+                posix_spawn_file_actions_adddup2(&file_actions, action.src, action.fd);
+                break;
+            case FdAction::Close:
+                posix_spawn_file_actions_addclose(&file_actions, action.fd);
+                break;
+            case FdAction::Open:
+                posix_spawn_file_actions_addopen(&file_actions, action.fd, action.path.c_str(), action.flags,
+                                                 action.mode);
+                break;
+        }
+    }
+
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    short flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+
+    sigset_t defaults, mask;
+    sigemptyset(&defaults);
+    for (int sig : SHELL_SIGNALS) sigaddset(&defaults, sig);
+    sigemptyset(&mask);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    posix_spawnattr_setsigmask(&attr, &mask);
+
+    if (pgroup >= 0) {
+        flags |= POSIX_SPAWN_SETPGROUP;
+        posix_spawnattr_setpgroup(&attr, pgroup);
+    }
+    posix_spawnattr_setflags(&attr, flags);
+
+    pid_t pid = -1;
+    int err = posix_spawn(&pid, path, &file_actions, &attr, argv, envp ? envp : environ);
+    posix_spawn_file_actions_destroy(&file_actions);
+    posix_spawnattr_destroy(&attr);
+
+    if (err != 0) {
+        errno = err;
+        return -1;
+    }
+    return pid;
+}
+
+pid_t spawn_process(const std::string& path, const std::vector<std::string>& argv,
+                    const std::vector<FdAction>& actions, pid_t pgroup, char* const envp[]) {
+    std::vector<char*> c_args;
+    c_args.reserve(argv.size() + 1);
+    for (const auto& arg : argv) c_args.push_back(const_cast<char*>(arg.c_str()));
+    c_args.push_back(nullptr);
+    return spawn_process(path.c_str(), c_args.data(), actions, pgroup, envp);
+}
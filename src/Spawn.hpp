@@ -0,0 +1,42 @@
+#ifndef SHELL_STARTER_CPP_SPAWN_H
+#define SHELL_STARTER_CPP_SPAWN_H
+
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+// fd operation the child performs before exec, in order
+struct FdAction {
+    enum Kind { Dup2, Close, Open };
+
+    Kind kind;
+    int fd;           // target fd
+    int src = -1;     // Dup2: fd copied onto fd
+    std::string path; // Open
+    int flags = 0;
+    mode_t mode = 0644;
+
+    static FdAction dup2(int src, int fd) { return {Dup2, fd, src, {}}; }
+    static FdAction close(int fd) { return {Close, fd, -1, {}}; }
+    static FdAction open(int fd, std::string path, int flags, mode_t mode = 0644) {
+        return {Open, fd, -1, std::move(path), flags, mode};
+    }
+};
+
+// Starts path with posix_spawn (clone(CLONE_VM|CLONE_VFORK) in glibc), so the shell's page tables are never copied.
+// pgroup: -1 stays in the shell's group, 0 starts a new group, otherwise joins that group.
+// Signals the shell ignores or blocks are back to their defaults in the child.
+// envp: the child's environment, nullptr for the shell's own (environ).
+// Returns the pid, or -1 with errno set when the program couldn't be started.
+pid_t spawn_process(const std::string& path, const std::vector<std::string>& argv,
+                    const std::vector<FdAction>& actions = {}, pid_t pgroup = -1, char* const envp[] = nullptr);
+
+// same, with an argv that is already NULL terminated
+pid_t spawn_process(const char* path, char* const argv[], const std::vector<FdAction>& actions = {},
+                    pid_t pgroup = -1, char* const envp[] = nullptr);
+
+// for children that are forked instead: default dispositions and an empty signal mask
+void reset_child_signals();
+
+
+#endif //SHELL_STARTER_CPP_SPAWN_H
@@ -0,0 +1,45 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+// Worker threads with one shared FIFO queue
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    thread_count = std::clamp<size_t>(threads, 1, MAX_THREADS);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard lock(mutex);
+        tasks.push_back(std::move(task));
+        // one more worker per task until the pool is full, a single quick task only costs one thread
+        if (workers.size() < thread_count && workers.size() < tasks.size()) {
+            workers.emplace_back([this]() { work(); });
+        }
+    }
+    wake.notify_one();
+}
+
+void ThreadPool::work() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (tasks.empty()) return; // stopping and nothing left
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef SHELL_STARTER_CPP_THREADPOOL_H
+#define SHELL_STARTER_CPP_THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small fixed pool for work the shell does next to the prompt (PATH scans, ...).
+// Workers are started on the first submit, so a shell that never uses the pool never creates a thread.
+// Forked children don't have the workers: nothing submitted there would ever run.
+class ThreadPool {
+public:
+    // threads 0 = one per CPU, at most MAX_THREADS
+    explicit ThreadPool(size_t threads = 0);
+    // runs what is still queued, then joins
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+    size_t size() const { return thread_count; }
+
+    static constexpr size_t MAX_THREADS = 8;
+
+private:
+    size_t thread_count;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::function<void()>> tasks;
+    bool stopping = false;
+
+    void work();
+};
+
+
+#endif //SHELL_STARTER_CPP_THREADPOOL_H
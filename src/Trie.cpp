@@ -2,64 +2,291 @@
 // Created by Thomas Devlamminck on 19/01/2026.
 //
 
+#include <algorithm>
+#include <atomic>
 #include <string>
-#include <unordered_map>
 #include "Trie.hpp"
 #include <vector>
 
 // Trie used for autocompletion
 
-void Trie::collectAllWords(TrieNode* node, const std::string& currentPrefix, std::vector<std::string> & results) {
-    if (node->endofWord) {
-        results.push_back(currentPrefix);
+namespace {
+    std::atomic<uint64_t> generations{0};
+}
+
+uint32_t Trie::find_child(uint32_t node, unsigned char c) const {
+    const Node& n = nodes[node];
+    auto begin = edges.begin() + n.edges_off;
+    auto end = begin + n.edges_len;
+    auto it = std::lower_bound(begin, end, c, [](const Edge& e, unsigned char ch) { return e.first < ch; });
+    return (it != end && it->first == c) ? it->node : NONE;
+}
+
+void Trie::add_edge(uint32_t node, unsigned char c, uint32_t child) {
+    if (nodes[node].edges_len == nodes[node].edges_cap) {
+        // grow the slice; in place when it is the last one, otherwise move it to the end
+        uint16_t cap = nodes[node].edges_cap;
+        uint16_t new_cap = cap == 0 ? 2 : std::min<uint16_t>(cap * 2, 256);
+        uint32_t off = nodes[node].edges_off;
+
+        if (cap > 0 && off + cap == edges.size()) {
+            edges.resize(off + new_cap);
+        } else {
+            uint32_t new_off = edges.size();
+            edges.resize(new_off + new_cap);
+            std::copy_n(edges.begin() + off, nodes[node].edges_len, edges.begin() + new_off);
+            nodes[node].edges_off = new_off;
+        }
+        nodes[node].edges_cap = new_cap;
+    }
+
+    Node& n = nodes[node];
+    auto begin = edges.begin() + n.edges_off;
+    auto end = begin + n.edges_len;
+    auto it = std::lower_bound(begin, end, c, [](const Edge& e, unsigned char ch) { return e.first < ch; });
+    std::copy_backward(it, end, end + 1);
+    *it = Edge{c, child};
+    n.edges_len++;
+}
+
+uint32_t Trie::new_leaf(std::string_view suffix) {
+    Node leaf;
+    leaf.label_off = labels.size();
+    leaf.label_len = suffix.size();
+    leaf.terminal = true;
+    labels.append(suffix);
+    nodes.push_back(leaf);
+    return nodes.size() - 1;
+}
+
+void Trie::insert(std::string_view word) {
+    changed = ++generations;
+    uint32_t node = 0;
+    size_t i = 0;
+
+    while (i < word.size()) {
+        uint32_t child = find_child(node, word[i]);
+        if (child == NONE) {
+            uint32_t leaf = new_leaf(word.substr(i));
+            add_edge(node, word[i], leaf);
+            return;
+        }
+
+        std::string_view edge = label(child);
+        std::string_view rest = word.substr(i);
+        size_t k = std::mismatch(edge.begin(), edge.end(), rest.begin(), rest.end()).first - edge.begin();
+
+        if (k == edge.size()) {
+            node = child;
+            i += k;
+            continue;
+        }
+
+        // split child after k bytes: the tail keeps its children and end of word flag
+        Node tail = nodes[child];
+        tail.label_off += k;
+        tail.label_len -= k;
+        nodes.push_back(tail);
+        uint32_t tail_idx = nodes.size() - 1;
+
+        Node& head = nodes[child];
+        head.label_len = k;
+        head.edges_off = 0;
+        head.edges_len = 0;
+        head.edges_cap = 0;
+        head.terminal = false;
+        add_edge(child, edge[k], tail_idx);
+
+        i += k;
+        if (i == word.size()) {
+            nodes[child].terminal = true;
+        } else {
+            uint32_t leaf = new_leaf(word.substr(i));
+            add_edge(child, word[i], leaf);
+        }
+        return;
+    }
+
+    nodes[node].terminal = true;
+}
+
+void Trie::remove_edge(uint32_t node, unsigned char c) {
+    Node& n = nodes[node];
+    auto begin = edges.begin() + n.edges_off;
+    auto end = begin + n.edges_len;
+    auto it = std::lower_bound(begin, end, c, [](const Edge& e, unsigned char ch) { return e.first < ch; });
+    if (it == end || it->first != c) return;
+    std::copy(it + 1, end, it);
+    n.edges_len--;
+}
+
+void Trie::merge_with_child(uint32_t node) {
+    uint32_t child = edges[nodes[node].edges_off].node;
+
+    // the joined label goes to the end, the old pieces become garbage
+    uint32_t off = labels.size();
+    labels.append(label(node));
+    labels.append(label(child));
+
+    Node merged = nodes[child];
+    merged.label_off = off;
+    merged.label_len = nodes[node].label_len + nodes[child].label_len;
+    nodes[node] = merged;
+    dead_nodes++;
+}
+
+bool Trie::remove(std::string_view word) {
+    // nodes from the root down to the word's node
+    std::vector<uint32_t> path{0};
+    size_t i = 0;
+    while (i < word.size()) {
+        uint32_t child = find_child(path.back(), word[i]);
+        if (child == NONE) return false;
+        std::string_view edge = label(child);
+        if (word.substr(i, edge.size()) != edge) return false;
+        path.push_back(child);
+        i += edge.size();
     }
-    for (auto const& [ch, childNode] : node->children) {
-        collectAllWords(childNode, currentPrefix + ch, results);
+
+    uint32_t node = path.back();
+    if (!nodes[node].terminal) return false;
+    nodes[node].terminal = false;
+    changed = ++generations;
+
+    if (node != 0) {
+        uint32_t parent = path[path.size() - 2];
+        if (nodes[node].edges_len == 0) {
+            // a leaf goes away, its parent may be left with a single child
+            remove_edge(parent, labels[nodes[node].label_off]);
+            dead_nodes++;
+            if (parent != 0 && !nodes[parent].terminal && nodes[parent].edges_len == 1) merge_with_child(parent);
+        } else if (nodes[node].edges_len == 1) {
+            merge_with_child(node);
+        }
     }
+
+    if (dead_nodes > 64 && dead_nodes > nodes.size() / 2) compact();
+    return true;
+}
+
+bool Trie::contains(std::string_view word) const {
+    size_t label_pos = 0;
+    uint32_t node = locate(word, label_pos);
+    return node != NONE && label_pos == nodes[node].label_len && nodes[node].terminal;
 }
 
-void Trie::insert(const std::string& word) const {
-    TrieNode* node = root;
-    for (char c : word) {
-        if (node->children.find(c) == node->children.end()) {
-            node->children[c] = new TrieNode();
+void Trie::compact() {
+    Trie fresh;
+    fresh.nodes.reserve(nodes.size() - dead_nodes);
+    fresh.labels.reserve(labels.size() / 2);
+    for_each_completion("", [&fresh](std::string_view word) {
+        fresh.insert(word);
+        return true;
+    });
+    *this = std::move(fresh);
+}
+
+uint32_t Trie::locate(std::string_view prefix, size_t& label_pos) const {
+    uint32_t node = 0;
+    size_t i = 0;
+
+    while (i < prefix.size()) {
+        uint32_t child = find_child(node, prefix[i]);
+        if (child == NONE) return NONE;
+
+        std::string_view edge = label(child);
+        std::string_view rest = prefix.substr(i);
+        size_t k = std::mismatch(edge.begin(), edge.end(), rest.begin(), rest.end()).first - edge.begin();
+
+        if (i + k == prefix.size()) {
+            // prefix ends inside (or at the end of) this edge
+            label_pos = k;
+            return child;
         }
-        node = node->children[c];
+        if (k < edge.size()) return NONE;
+
+        node = child;
+        i += k;
     }
-    node->endofWord = true;
+
+    label_pos = nodes[node].label_len;
+    return node;
 }
 
-std::vector<std::string> Trie::get_completions(const std::string& prefix) {
-    TrieNode* node = root;
-    for (char c : prefix) {
-        if (node->children.find(c) == node->children.end()) {
-            return {}; // No matches
+size_t Trie::for_each_completion(std::string_view prefix, const std::function<bool(std::string_view)>& visit,
+                                 size_t limit) const {
+    size_t label_pos = 0;
+    uint32_t start = locate(prefix, label_pos);
+    if (start == NONE) return 0; // No matches
+
+    // one buffer for the whole walk, each stack frame remembers how long the word was at that node
+    std::string word(prefix);
+    word += label(start).substr(label_pos);
+
+    struct Frame {
+        uint32_t node;
+        uint32_t next_edge;
+        size_t word_len;
+    };
+    std::vector<Frame> stack;
+    stack.reserve(32);
+    stack.push_back({start, 0, word.size()});
+
+    size_t visited = 0;
+    if (nodes[start].terminal) {
+        visited++;
+        if (!visit(word) || visited == limit) return visited;
+    }
+
+    while (!stack.empty()) {
+        Frame& top = stack.back();
+        const Node& n = nodes[top.node];
+        if (top.next_edge == n.edges_len) {
+            stack.pop_back();
+            continue;
         }
-        node = node->children[c];
+
+        uint32_t child = edges[n.edges_off + top.next_edge++].node;
+        word.resize(top.word_len);
+        word += label(child);
+
+        // edges are sorted, so a word is always visited before any longer word below it
+        if (nodes[child].terminal) {
+            visited++;
+            if (!visit(word) || visited == limit) return visited;
+        }
+        stack.push_back({child, 0, word.size()});
     }
+    return visited;
+}
+
+std::vector<std::string> Trie::get_completions(const std::string& prefix, size_t limit) const {
     std::vector<std::string> results;
-    collectAllWords(node, prefix, results);
+    for_each_completion(prefix, [&results](std::string_view word) {
+        results.emplace_back(word);
+        return true;
+    }, limit);
     return results;
 }
 
 std::string Trie::getLongestCommonPrefix(std::string prefix) const {
-    TrieNode* node = root;
+    size_t label_pos = 0;
+    uint32_t node = locate(prefix, label_pos);
+    if (node == NONE) return prefix; // No matches at all
 
-    // go to the end of prefix
-    for (char c : prefix) {
-        if (node->children.find(c) == node->children.end()) {
-            return prefix; // No matches at all
-        }
-        node = node->children[c];
-    }
+    // the rest of the edge is shared by every match
+    std::string lcp = prefix;
+    lcp += label(node).substr(label_pos);
 
     // keep going if there is only one child + not end of word
-    std::string lcp = prefix;
-    while (node->children.size() == 1 && !node->endofWord) {
-        auto it = node->children.begin();
-        lcp += it->first;
-        node = it->second;
+    while (nodes[node].edges_len == 1 && !nodes[node].terminal) {
+        node = edges[nodes[node].edges_off].node;
+        lcp += label(node);
     }
 
     return lcp;
 }
+
+size_t Trie::memory_usage() const {
+    return nodes.capacity() * sizeof(Node) + edges.capacity() * sizeof(Edge) + labels.capacity();
+}
@@ -5,39 +5,78 @@
 #ifndef SHELL_STARTER_CPP_TRIE_H
 #define SHELL_STARTER_CPP_TRIE_H
 
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
 #include <vector>
 
-class TrieNode {
-public:
-    bool endofWord;
-    std::unordered_map<char, TrieNode*> children;
+// Path-compressed (radix) trie stored in flat arrays.
+// Nodes, edges and labels live in three vectors and refer to each other with 32-bit indices,
+// so the whole structure is freed at once and lookups don't chase heap pointers.
+class Trie {
+    static constexpr uint32_t NONE = UINT32_MAX;
 
-    TrieNode() : endofWord(false){}
+    struct Node {
+        uint32_t label_off = 0; // edge label leading into this node, slice of labels
+        uint32_t label_len = 0;
+        uint32_t edges_off = 0; // children, slice of edges sorted by first byte
+        uint16_t edges_len = 0;
+        uint16_t edges_cap = 0;
+        bool terminal = false;
+    };
 
-    ~TrieNode() {
-        for (auto& pair : children) {
-            delete pair.second;
-        }
-    }
-};
+    struct Edge {
+        unsigned char first; // first byte of the child's label
+        uint32_t node;
+    };
 
+    std::vector<Node> nodes; // nodes[0] is the root
+    std::vector<Edge> edges;
+    std::string labels;
+    size_t dead_nodes = 0; // unlinked by remove, reclaimed by compact()
+    uint64_t changed = 0;  // generation of the last insert / remove
 
-class Trie {
-    TrieNode* root;
+    std::string_view label(uint32_t node) const {
+        return {labels.data() + nodes[node].label_off, nodes[node].label_len};
+    }
+    uint32_t find_child(uint32_t node, unsigned char c) const;
+    void add_edge(uint32_t node, unsigned char c, uint32_t child);
+    uint32_t new_leaf(std::string_view suffix);
+    void remove_edge(uint32_t node, unsigned char c);
+    // node takes over the label, children and flag of its only child
+    void merge_with_child(uint32_t node);
+    // rebuilds the arrays without the nodes, edges and labels remove left behind
+    void compact();
 
-    // Helper for recursive prefix searching
-    static void collectAllWords(TrieNode* node, const std::string& currentPrefix, std::vector<std::string>& results);
+    // node whose path starts with prefix, label_pos = how much of its label the prefix used
+    uint32_t locate(std::string_view prefix, size_t& label_pos) const;
 
 public:
-    Trie() {root = new TrieNode();}
-    ~Trie() { delete root; }
+    Trie() { nodes.emplace_back(); }
+
+    void insert(std::string_view word);
+    // false when word wasn't in the trie
+    bool remove(std::string_view word);
+    bool contains(std::string_view word) const;
 
-    void insert(const std::string& word) const;
+    // Calls visit for every word starting with prefix, in lexicographic (byte) order.
+    // The view is only valid during the call, returning false stops the walk. limit 0 = no limit.
+    // Returns the number of words visited.
+    size_t for_each_completion(std::string_view prefix, const std::function<bool(std::string_view)>& visit,
+                               size_t limit = 0) const;
 
-    std::vector<std::string> get_completions(const std::string& prefix);
+    std::vector<std::string> get_completions(const std::string& prefix, size_t limit = 0) const;
 
     std::string getLongestCommonPrefix(std::string prefix) const;
+
+    // changes with every insert and remove, never the same for two tries: caches built from the words key on it
+    uint64_t generation() const { return changed; }
+
+    // bytes reserved by the arena arrays
+    size_t memory_usage() const;
+    size_t node_count() const { return nodes.size(); }
 };
 
 
-#endif //SHELL_STARTER_CPP_TRIE_H
\ No newline at end of file
+#endif //SHELL_STARTER_CPP_TRIE_H
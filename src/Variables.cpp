@@ -0,0 +1,118 @@
+#include "Variables.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// Variable store and the cached environment for exec
+
+bool Variables::valid_name(std::string_view name) {
+    if (name.empty() || (name[0] >= '0' && name[0] <= '9')) return false;
+    return std::all_of(name.begin(), name.end(), [](char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    });
+}
+
+void Variables::import_environment(char** environment) {
+    vars.clear();
+    for (char** e = environment; e && *e; ++e) {
+        std::string_view entry(*e);
+        size_t eq = entry.find('=');
+        if (eq == std::string_view::npos) continue;
+        vars[std::string(entry.substr(0, eq))] = {std::string(entry.substr(eq + 1)), true};
+    }
+    env_stale = true;
+}
+
+const std::string* Variables::get(std::string_view name) const {
+    auto it = vars.find(std::string(name));
+    return it == vars.end() || !it->second.set ? nullptr : &it->second.value;
+}
+
+void Variables::set(std::string_view name, std::string value) {
+    Var& var = vars[std::string(name)];
+    var.value = std::move(value);
+    var.set = true;
+    if (var.exported) {
+        setenv(std::string(name).c_str(), var.value.c_str(), 1);
+        env_stale = true;
+    }
+}
+
+void Variables::export_name(std::string_view name, const std::string* value) {
+    auto [it, added] = vars.try_emplace(std::string(name));
+    Var& var = it->second;
+    // export NAME of a name never set: in the environment once it gets a value
+    if (added) var.set = false;
+    if (value) {
+        var.value = *value;
+        var.set = true;
+    }
+    var.exported = true;
+    if (var.set) {
+        setenv(std::string(name).c_str(), var.value.c_str(), 1);
+        env_stale = true;
+    }
+}
+
+void Variables::unset(std::string_view name) {
+    auto it = vars.find(std::string(name));
+    if (it == vars.end()) return;
+    if (it->second.exported) {
+        unsetenv(it->first.c_str());
+        env_stale = true;
+    }
+    vars.erase(it);
+}
+
+bool Variables::is_exported(std::string_view name) const {
+    auto it = vars.find(std::string(name));
+    return it != vars.end() && it->second.exported;
+}
+
+std::vector<std::pair<std::string, std::string>> Variables::exported() const {
+    std::vector<std::pair<std::string, std::string>> out;
+    for (const auto& [name, var] : vars) {
+        if (var.exported && var.set) out.emplace_back(name, var.value);
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+void Variables::rebuild_env() {
+    env_strings.clear();
+    for (const auto& [name, var] : vars) {
+        if (var.exported && var.set) env_strings.push_back(name + "=" + var.value);
+    }
+    // pointers only once every string is in place, the vector doesn't move them anymore
+    env.clear();
+    env.reserve(env_strings.size() + 1);
+    for (auto& entry : env_strings) env.push_back(entry.data());
+    env.push_back(nullptr);
+    env_stale = false;
+    builds++;
+}
+
+char* const* Variables::envp() {
+    if (env_stale) rebuild_env();
+    return env.data();
+}
+
+std::vector<char*> Variables::envp_with(const std::vector<std::string>& assignments,
+                                        std::vector<std::string>& storage) {
+    storage = assignments;
+    std::vector<char*> out;
+    char* const* base = envp();
+    for (char* const* e = base; *e; ++e) {
+        // replaced by an assignment?
+        const char* eq = std::strchr(*e, '=');
+        size_t name_len = eq ? eq - *e : std::strlen(*e);
+        bool replaced = std::any_of(assignments.begin(), assignments.end(), [&](const std::string& a) {
+            return a.size() > name_len && a[name_len] == '=' && a.compare(0, name_len, *e, name_len) == 0;
+        });
+        if (!replaced) out.push_back(*e);
+    }
+    for (auto& entry : storage) out.push_back(entry.data());
+    out.push_back(nullptr);
+    return out;
+}
@@ -0,0 +1,58 @@
+#ifndef SHELL_STARTER_CPP_VARIABLES_H
+#define SHELL_STARTER_CPP_VARIABLES_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Shell and exported variables.
+// Starts out as a copy of the environment. The NAME=value array handed to exec is built once and kept until an
+// exported variable changes, so launching a command costs nothing for the environment. Exported changes are also
+// made with setenv() / unsetenv(), for the getenv() callers (PATH lookup, HOME, HISTFILE).
+class Variables {
+public:
+    // the process environment, everything exported
+    void import_environment(char** env);
+
+    // nullptr when name is unset
+    const std::string* get(std::string_view name) const;
+    // keeps whether name is exported
+    void set(std::string_view name, std::string value);
+    // marks name exported, value: set it too
+    void export_name(std::string_view name, const std::string* value = nullptr);
+    void unset(std::string_view name);
+    bool is_exported(std::string_view name) const;
+
+    // exported variables sorted by name (export -p)
+    std::vector<std::pair<std::string, std::string>> exported() const;
+
+    // NULL terminated NAME=value array of the exported variables, valid until the next change to one of them
+    char* const* envp();
+    // envp() with extra NAME=value entries replacing or adding to it (FOO=bar cmd), storage keeps the strings
+    std::vector<char*> envp_with(const std::vector<std::string>& assignments, std::vector<std::string>& storage);
+    // how often envp() had to be built, for shell_bench
+    uint64_t envp_builds() const { return builds; }
+
+    static bool valid_name(std::string_view name);
+
+private:
+    struct Var {
+        std::string value;
+        bool exported = false;
+        bool set = true; // false: export NAME before NAME has a value
+    };
+
+    std::unordered_map<std::string, Var> vars;
+    std::vector<std::string> env_strings;
+    std::vector<char*> env;
+    bool env_stale = true;
+    uint64_t builds = 0;
+
+    void rebuild_env();
+};
+
+
+#endif //SHELL_STARTER_CPP_VARIABLES_H
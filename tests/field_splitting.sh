@@ -0,0 +1,6 @@
+# IFS whitespace runs are one delimiter, every other IFS character ends a field (an empty one too)
+IFS=' :'
+x=' a : b::c: '
+printf '<%s>' $x "d\
+e"
+echo
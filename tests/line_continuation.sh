@@ -0,0 +1,5 @@
+# \<newline> is removed: between words, inside a word and inside double quotes
+echo a \
+b c\
+d "e\
+f"